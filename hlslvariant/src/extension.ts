@@ -57,7 +57,7 @@ export function activate(context: vscode.ExtensionContext) {
 	const serverExe: Executable = {
 		command: serverModule,
 		transport: TransportKind.stdio,
-		args: [],
+		args: vscode.workspace.getConfiguration('hlslvariant').get<string[]>('server.arguments', []),
 		options: {shell: true, detached: false }
 	};
 	const serverOptions: ServerOptions = serverExe;
@@ -0,0 +1,213 @@
+// Replays synthetic edit traces against the text storages and reports how long each edit took.
+//
+// Usage: HLSLVBenchmark [--lines=N] [--ops=N] [--seed=N]
+//
+// For every trace and backend it prints:
+//   ns/op:       Mean time of one operation, including the line index update in the "+lines" rows.
+//   p50, p99:    Latency percentiles of a single operation.
+//   copied/op:   Bytes the storage moved or copied per operation (gap moves, growth, appends, compaction).
+//
+// Before that, the text scanning kernels the CPU supports are checked against the scalar ones on random data.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#include "GapBufferStorage.h"
+#include "PieceTree.h"
+#include "LineIndex.h"
+#include "StorageStats.h"
+#include "BufferAllocator.h"
+#include "EditTrace.h"
+#include "TextScan.h"
+
+struct BenchmarkResult
+{
+	double nsPerOp = 0.0;
+	double p50 = 0.0;
+	double p99 = 0.0;
+	double copiedPerOp = 0.0;
+	uint64_t hash = 0;
+};
+
+static std::unique_ptr<TextStorage> CreateStorage(TextStorageKind kind, const std::string& text)
+{
+	const TextStorage::Type* pData = (const TextStorage::Type*)text.data();
+	if (kind == TextStorageKind::PieceTree)
+		return std::make_unique<PieceTree>(pData, text.size());
+	// Same gap as Document uses.
+	return std::make_unique<GapBufferStorage>(pData, text.size(), std::max<size_t>(text.size() / 4, 1024));
+}
+
+// FNV-1a of the final text, the backends must agree on it.
+static uint64_t HashText(const TextStorage& storage)
+{
+	std::vector<TextStorage::Type> text(storage.GetCount());
+	storage.CopyTo(text.data());
+
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (TextStorage::Type byte : text)
+		hash = (hash ^ byte) * 0x100000001B3ull;
+	return hash;
+}
+
+static BenchmarkResult Replay(TextStorageKind kind, const std::string& document, const EditTrace& trace, bool updateLines)
+{
+	std::unique_ptr<TextStorage> pStorage = CreateStorage(kind, document);
+	LineIndex lines;
+	if (updateLines)
+		lines.Build(*pStorage);
+
+	std::vector<double> latencies;
+	latencies.reserve(trace.ops.size());
+	std::vector<TextEdit> edits;
+
+	const size_t copiedBefore = StorageStats::s_CopiedBytes;
+	for (const TraceOp& op : trace.ops)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		if (op.edits.size() == 1)
+		{
+			const TraceEdit& edit = op.edits[0];
+			pStorage->Erase(edit.start, edit.eraseCount);
+			pStorage->Insert(edit.start, (const TextStorage::Type*)edit.text.data(), edit.text.size());
+			if (updateLines)
+				lines.Edit(*pStorage, edit.start, edit.start + edit.eraseCount, edit.start + edit.text.size());
+		}
+		else
+		{
+			// Same as Document::ApplyChangeBatch, one storage batch and one line index update per group of edits on the same lines.
+			edits.clear();
+			for (const TraceEdit& edit : op.edits)
+				edits.push_back({ edit.start, edit.eraseCount, (const TextStorage::Type*)edit.text.data(), edit.text.size() });
+			pStorage->ApplyEdits(edits.data(), edits.size());
+			if (updateLines)
+				lines.EditBatch(*pStorage, edits.data(), edits.size());
+		}
+
+		const auto end = std::chrono::steady_clock::now();
+		latencies.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+	const size_t copied = StorageStats::s_CopiedBytes - copiedBefore;
+
+	BenchmarkResult result;
+	if (!latencies.empty())
+	{
+		double total = 0.0;
+		for (double latency : latencies)
+			total += latency;
+		result.nsPerOp = total / latencies.size();
+		result.copiedPerOp = (double)copied / latencies.size();
+
+		std::sort(latencies.begin(), latencies.end());
+		result.p50 = latencies[latencies.size() / 2];
+		result.p99 = latencies[std::min(latencies.size() - 1, latencies.size() * 99 / 100)];
+	}
+	result.hash = HashText(*pStorage);
+	return result;
+}
+
+static size_t ParseCount(std::string_view arg, std::string_view name, size_t fallback)
+{
+	if (arg.substr(0, name.size()) != name)
+		return fallback;
+	return (size_t)std::strtoull(arg.data() + name.size(), nullptr, 10);
+}
+
+int main(int argc, char** argv)
+{
+	size_t lineCount = 20000;
+	size_t opCount = 20000;
+	size_t seed = 1;
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		lineCount = ParseCount(arg, "--lines=", lineCount);
+		opCount = ParseCount(arg, "--ops=", opCount);
+		seed = ParseCount(arg, "--seed=", seed);
+	}
+
+	EditTraceGenerator generator((uint32_t)seed);
+	const std::string document = generator.GenerateDocument(lineCount);
+
+	std::vector<EditTrace> traces;
+	traces.push_back(generator.Typing(document.size(), opCount));
+	traces.push_back(generator.Paste(document.size(), opCount / 10));
+	traces.push_back(generator.LargeDelete(document.size(), opCount / 10));
+	traces.push_back(generator.RandomJumps(document.size(), opCount));
+	traces.push_back(generator.ReplaceAll(document.size(), opCount / 100, 64));
+
+	// The vector kernels only run on CPUs that have them, so they are checked here rather than trusted.
+	int exitCode = 0;
+	std::printf("Text scanning: %s kernels\n", TextScan::GetKernelName());
+	if (const char* pFailedKernels = TextScan::VerifyKernels((uint32_t)seed, 20000))
+	{
+		std::printf("  %s kernels differ from the scalar ones!\n", pFailedKernels);
+		exitCode = 1;
+	}
+
+	std::printf("Document: %zu lines, %zu bytes, seed %zu\n\n", lineCount, document.size(), seed);
+	std::printf("%-14s %-18s %8s %12s %12s %12s %14s\n", "trace", "backend", "ops", "ns/op", "p50 ns", "p99 ns", "copied B/op");
+
+	struct Backend { const char* name; TextStorageKind kind; bool updateLines; };
+	const Backend backends[] =
+	{
+		{ "gapbuffer", TextStorageKind::GapBuffer, false },
+		{ "piecetree", TextStorageKind::PieceTree, false },
+		{ "gapbuffer+lines", TextStorageKind::GapBuffer, true },
+		{ "piecetree+lines", TextStorageKind::PieceTree, true },
+	};
+
+	for (const EditTrace& trace : traces)
+	{
+		uint64_t expectedHash = 0;
+		for (const Backend& backend : backends)
+		{
+			const BenchmarkResult result = Replay(backend.kind, document, trace, backend.updateLines);
+			std::printf("%-14s %-18s %8zu %12.1f %12.1f %12.1f %14.1f\n",
+				trace.name.c_str(), backend.name, trace.ops.size(), result.nsPerOp, result.p50, result.p99, result.copiedPerOp);
+
+			if (&backend == &backends[0])
+				expectedHash = result.hash;
+			else if (result.hash != expectedHash)
+			{
+				std::printf("  Text of %s differs from %s!\n", backend.name, backends[0].name);
+				exitCode = 1;
+			}
+		}
+	}
+
+	// Many small shaders opened, typed in and closed, like browsing through a project.
+	{
+		std::vector<std::string> shaders;
+		for (size_t i = 0; i < 64; ++i)
+			shaders.push_back(generator.GenerateDocument(10 + i * 8));
+
+		const size_t churnCount = opCount / 10;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < churnCount; ++i)
+		{
+			std::unique_ptr<TextStorage> pStorage = CreateStorage(TextStorageKind::GapBuffer, shaders[i % shaders.size()]);
+			for (size_t c = 0; c < 256; ++c)
+				pStorage->Insert(pStorage->GetCount() / 2, (const TextStorage::Type*)"x", 1);
+		}
+		const auto end = std::chrono::steady_clock::now();
+		if (churnCount > 0)
+			std::printf("\nOpen, type and close: %zu documents, %.1f ns/document\n", churnCount,
+				(double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / churnCount);
+	}
+
+	// Every storage was destroyed, what is left is what the allocator keeps cached for the next document.
+	const BufferAllocator::Stats stats = BufferAllocator::GetDefault().GetStats();
+	std::printf("Gap buffer allocator: %zu allocations (%zu reused), peak %zu KiB, %zu KiB live, %zu KiB cached (%.0f%% idle)\n",
+		stats.allocationCount, stats.reuseCount, stats.peakUsedBytes / 1024, stats.usedBytes / 1024, stats.cachedBytes / 1024, stats.GetIdleFraction() * 100.0);
+
+	return exitCode;
+}
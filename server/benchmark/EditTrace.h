@@ -0,0 +1,205 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// A single replace in a trace, in offsets from before the operation.
+struct TraceEdit
+{
+	size_t start = 0;
+	size_t eraseCount = 0;
+	std::string text;
+};
+
+// One client notification. More than one edit is applied as a batch, like a replace-all.
+struct TraceOp
+{
+	std::vector<TraceEdit> edits;
+};
+
+struct EditTrace
+{
+	std::string name;
+	std::vector<TraceOp> ops;
+};
+
+// Generates the base document and synthetic edit traces modelled on how a shader gets edited.
+// The generator tracks the document length so every edit is in bounds when replayed in order.
+struct EditTraceGenerator
+{
+public:
+	EditTraceGenerator(uint32_t seed) : m_State(seed != 0 ? seed : 1) {}
+
+	// Shader-like text, mostly ASCII with a comment line holding multi-byte characters now and then.
+	std::string GenerateDocument(size_t lineCount)
+	{
+		static const char* s_Lines[] =
+		{
+			"cbuffer PerFrame : register(b0)\n",
+			"{\n",
+			"    float4x4 viewProjection;\n",
+			"    float3 cameraPosition;\n",
+			"};\n",
+			"\n",
+			"float4 main(VSOutput input) : SV_TARGET\n",
+			"    float3 normal = normalize(input.normal);\n",
+			"    float ndotl = saturate(dot(normal, -lightDirection));\n",
+			"    return float4(albedo.rgb * ndotl, 1.0f);\n",
+			"    // Lambert \xC3\xA4 \xE2\x80\x94 diffuse term\n",
+			"#if defined(VARIANT_SHADOWS)\n",
+			"    float shadow = SampleShadow(input.shadowCoord);\n",
+			"#endif\n",
+			"}\n",
+		};
+		constexpr size_t lineKinds = sizeof(s_Lines) / sizeof(s_Lines[0]);
+
+		std::string text;
+		for (size_t i = 0; i < lineCount; ++i)
+			text += s_Lines[Next() % lineKinds];
+		return text;
+	}
+
+	// Short bursts at one cursor: mostly single characters, some newlines and backspaces, and a small cursor move between bursts.
+	EditTrace Typing(size_t documentCount, size_t opCount)
+	{
+		EditTrace trace;
+		trace.name = "typing";
+		size_t count = documentCount;
+		size_t cursor = count / 2;
+		for (size_t i = 0; i < opCount; ++i)
+		{
+			if (i % 32 == 0)
+				cursor = Clamp(cursor + Range(0, 400) - 200, count);
+
+			TraceOp op;
+			const uint32_t roll = Range(0, 100);
+			if (roll < 10 && cursor > 0)
+			{
+				op.edits.push_back({ cursor - 1, 1, "" });
+				cursor -= 1;
+				count -= 1;
+			}
+			else
+			{
+				op.edits.push_back({ cursor, 0, roll < 15 ? "\n" : std::string(1, (char)('a' + Range(0, 26))) });
+				cursor += 1;
+				count += 1;
+			}
+			trace.ops.push_back(std::move(op));
+		}
+		return trace;
+	}
+
+	// Blocks of a few hundred bytes to a few KiB pasted at random offsets.
+	EditTrace Paste(size_t documentCount, size_t opCount)
+	{
+		EditTrace trace;
+		trace.name = "paste";
+		const std::string block = GenerateDocument(128);
+		size_t count = documentCount;
+		for (size_t i = 0; i < opCount; ++i)
+		{
+			const size_t start = Range(0, (uint32_t)block.size() / 2);
+			const size_t length = Range(200, (uint32_t)(block.size() - start));
+			TraceOp op;
+			op.edits.push_back({ Range(0, (uint32_t)count + 1), 0, block.substr(start, length) });
+			count += length;
+			trace.ops.push_back(std::move(op));
+		}
+		return trace;
+	}
+
+	// Deletes of up to 64 KiB, each followed by a paste of the same size so the document does not run dry.
+	EditTrace LargeDelete(size_t documentCount, size_t opCount)
+	{
+		EditTrace trace;
+		trace.name = "large delete";
+		const std::string block = GenerateDocument(2048);
+		size_t count = documentCount;
+		for (size_t i = 0; i < opCount; ++i)
+		{
+			TraceOp op;
+			if (i % 2 == 0)
+			{
+				const size_t length = Range(1024, 64 * 1024) % (count + 1);
+				op.edits.push_back({ Range(0, (uint32_t)(count - length + 1)), length, "" });
+				count -= length;
+				m_LastDeleteCount = length;
+			}
+			else
+			{
+				const size_t length = m_LastDeleteCount < block.size() ? m_LastDeleteCount : block.size();
+				op.edits.push_back({ Range(0, (uint32_t)count + 1), 0, block.substr(0, length) });
+				count += length;
+			}
+			trace.ops.push_back(std::move(op));
+		}
+		return trace;
+	}
+
+	// Single characters at uniformly random offsets, the worst case for a gap buffer.
+	EditTrace RandomJumps(size_t documentCount, size_t opCount)
+	{
+		EditTrace trace;
+		trace.name = "random jumps";
+		size_t count = documentCount;
+		for (size_t i = 0; i < opCount; ++i)
+		{
+			TraceOp op;
+			op.edits.push_back({ Range(0, (uint32_t)count + 1), 0, "x" });
+			count += 1;
+			trace.ops.push_back(std::move(op));
+		}
+		return trace;
+	}
+
+	// Renames spread over the whole document, sent as one notification.
+	EditTrace ReplaceAll(size_t documentCount, size_t opCount, size_t editsPerOp)
+	{
+		EditTrace trace;
+		trace.name = "replace all";
+		size_t count = documentCount;
+		for (size_t i = 0; i < opCount; ++i)
+		{
+			TraceOp op;
+			const size_t stride = count / editsPerOp;
+			if (stride < 8)
+				break;
+
+			for (size_t e = 0; e < editsPerOp; ++e)
+				op.edits.push_back({ e * stride + Range(0, (uint32_t)stride - 6), 6, "renamed_" });
+			count += editsPerOp * 2;
+			trace.ops.push_back(std::move(op));
+		}
+		return trace;
+	}
+
+private:
+	static size_t Clamp(size_t value, size_t max)
+	{
+		// The cursor move is done in unsigned arithmetic, wrap-around means it went below zero.
+		if (value > max + 200)
+			return 0;
+		return value < max ? value : max;
+	}
+
+	// Returns a value in [min, max).
+	uint32_t Range(uint32_t min, uint32_t max)
+	{
+		return max > min ? min + Next() % (max - min) : min;
+	}
+
+	// Xorshift, deterministic for a given seed so runs can be compared.
+	uint32_t Next()
+	{
+		m_State ^= m_State << 13;
+		m_State ^= m_State >> 17;
+		m_State ^= m_State << 5;
+		return m_State;
+	}
+
+private:
+	uint32_t m_State;
+	size_t m_LastDeleteCount = 0;
+};
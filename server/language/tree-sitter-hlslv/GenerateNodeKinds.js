@@ -0,0 +1,109 @@
+/**
+ * Generates server/src/NodeKind.h from the node-types.json of the grammar, run by UpdateLanguage.bat after tree-sitter generate:
+ *
+ *   node GenerateNodeKinds.js src/node-types.json ../../src/NodeKind.h
+ *
+ * The header has an enum with every named node and keyword of the grammar and one with every field, so the server can switch on them
+ * instead of comparing ts_node_type() strings. The TSSymbol and TSFieldId numbers are only known to the generated parser,
+ * NodeKindTable maps them to the enums when the server starts.
+ */
+
+const fs = require("fs")
+
+const [inputPath, outputPath] = process.argv.slice(2)
+if (!inputPath || !outputPath) {
+    console.error("Usage: node GenerateNodeKinds.js <node-types.json> <NodeKind.h>")
+    process.exit(2)
+}
+
+// translation_unit -> TranslationUnit
+function toPascalCase(name) {
+    return name.split("_").filter(part => part.length > 0).map(part => part[0].toUpperCase() + part.slice(1)).join("")
+}
+
+const nodeTypes = JSON.parse(fs.readFileSync(inputPath, "utf8"))
+
+// Hidden rules (_declarator) never show up in a tree. Of the anonymous nodes only the keywords get a kind, punctuation is told apart by its text.
+const kinds = []
+const fields = new Set()
+for (const nodeType of nodeTypes) {
+    if (nodeType.named && !nodeType.type.startsWith("_"))
+        kinds.push({ name: nodeType.type, named: true, id: toPascalCase(nodeType.type) })
+    else if (!nodeType.named && /^[a-z][a-z0-9_]*$/.test(nodeType.type))
+        kinds.push({ name: nodeType.type, named: false, id: "Keyword" + toPascalCase(nodeType.type) })
+
+    for (const field of Object.keys(nodeType.fields || {}))
+        fields.add(field)
+}
+kinds.sort((a, b) => a.named !== b.named ? (a.named ? -1 : 1) : a.name < b.name ? -1 : a.name > b.name ? 1 : 0)
+const fieldNames = [...fields].sort()
+
+const ids = new Set()
+for (const kind of kinds) {
+    if (ids.has(kind.id)) {
+        console.error(`${kind.name} and another node are both called ${kind.id}`)
+        process.exit(1)
+    }
+    ids.add(kind.id)
+}
+
+const lines = []
+lines.push("// Generated by language/tree-sitter-hlslv/GenerateNodeKinds.js from node-types.json, do not edit. Run UpdateLanguage.bat after changing grammar.js.")
+lines.push("#pragma once")
+lines.push("")
+lines.push("#include <cstdint>")
+lines.push("#include <string_view>")
+lines.push("")
+lines.push("// Every named node of the grammar, and the keywords, to switch on instead of comparing ts_node_type() strings.")
+lines.push("// The kind of a node is looked up from its TSSymbol in NodeKindTable.")
+lines.push("enum class NodeKind : uint16_t")
+lines.push("{")
+lines.push("\tUnknown,\t// Not in the grammar the header was generated from, and punctuation.")
+for (const kind of kinds)
+    lines.push(`\t${kind.id},`)
+lines.push("\tCount,")
+lines.push("};")
+lines.push("")
+lines.push("// Every field of the grammar, looked up from its TSFieldId in NodeKindTable.")
+lines.push("enum class FieldKind : uint16_t")
+lines.push("{")
+lines.push("\tUnknown,")
+for (const field of fieldNames)
+    lines.push(`\t${toPascalCase(field)},`)
+lines.push("\tCount,")
+lines.push("};")
+lines.push("")
+lines.push("namespace NodeKinds")
+lines.push("{")
+lines.push("\tstruct KindName")
+lines.push("\t{")
+lines.push("\t\tstd::string_view name;")
+lines.push("\t\tbool named;")
+lines.push("\t};")
+lines.push("")
+lines.push("\t// Indexed by NodeKind.")
+lines.push("\tinline constexpr KindName s_KindNames[] =")
+lines.push("\t{")
+lines.push("\t\t{ \"\", false },")
+for (const kind of kinds)
+    lines.push(`\t\t{ "${kind.name}", ${kind.named} },`)
+lines.push("\t};")
+lines.push("")
+lines.push("\t// Indexed by FieldKind.")
+lines.push("\tinline constexpr std::string_view s_FieldNames[] =")
+lines.push("\t{")
+lines.push("\t\t\"\",")
+for (const field of fieldNames)
+    lines.push(`\t\t"${field}",`)
+lines.push("\t};")
+lines.push("")
+lines.push("\tstatic_assert(sizeof(s_KindNames) / sizeof(s_KindNames[0]) == (size_t)NodeKind::Count);")
+lines.push("\tstatic_assert(sizeof(s_FieldNames) / sizeof(s_FieldNames[0]) == (size_t)FieldKind::Count);")
+lines.push("")
+lines.push("\tconstexpr std::string_view GetName(NodeKind kind) { return s_KindNames[(size_t)kind].name; }")
+lines.push("\tconstexpr std::string_view GetName(FieldKind field) { return s_FieldNames[(size_t)field]; }")
+lines.push("}")
+lines.push("")
+
+fs.writeFileSync(outputPath, lines.join("\n"))
+console.log(`Wrote ${kinds.length} node kinds and ${fieldNames.length} fields to ${outputPath}`)
@@ -1,5 +1,8 @@
 call tree-sitter generate
 
+:: Node kinds and fields to switch on in the server
+call node GenerateNodeKinds.js src\node-types.json .\..\..\src\NodeKind.h
+
 :: Move tree-sitter parser to source
 robocopy src\ .\..\..\src\tree_sitter_hlslv *.h /E
 robocopy src\ .\..\..\src\tree_sitter_hlslv *.c /E
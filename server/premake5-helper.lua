@@ -8,19 +8,33 @@ function ExternalsIncludes()
 end
 
 function ExternalsLinks()
-    filter "configurations:Debug"
+    filter { "system:windows", "configurations:Debug" }
 		links
 		{
 			"%{libDir.lsp}Debug/lsp.lib",
 			"%{libDir.treeSitter}Debug/tree-sitter.lib"
 		}
 
-	filter "configurations:Release"
+	filter { "system:windows", "configurations:Release" }
 		links
 		{
 			"%{libDir.lsp}Release/lsp.lib",
 			"%{libDir.treeSitter}Release/tree-sitter.lib"
 		}
+
+	-- Single configuration builds (make, ninja) of the externals.
+	filter "system:not windows"
+		libdirs
+		{
+			"%{libDir.lsp}",
+			"%{libDir.treeSitter}"
+		}
+		links
+		{
+			"lsp",
+			"tree-sitter",
+			"pthread"
+		}
 	filter {}
 end
 
@@ -1,3 +1,10 @@
+-- premake5 --trace vs2022: Records the trace zones of src/Trace.h.
+newoption
+{
+	trigger = "trace",
+	description = "Record trace zones that can be saved as Chrome trace JSON (defines MSLP_TRACE)"
+}
+
 workspace "HLSLVariantLSPServer"
 	startproject "Server"
 	architecture "x64"
@@ -10,14 +17,16 @@ workspace "HLSLVariantLSPServer"
 	-- Disable C4201 nonstandard extension used: nameless struct/union
 	disablewarnings { "4201" }
 
-	-- Link warning suppression
-	-- LNK4006: Sympbol already defined in another library will pick first definition
-	-- LNK4099: Debugging Database file (pdb) missing for given obj
-	-- LNK4098: defaultlib 'library' conflicts with use of other libs; use /NODEFAULTLIB:library
-	linkoptions { "-IGNORE:4006,4099,4098" }
+	filter "toolset:msc*"
+		-- Link warning suppression
+		-- LNK4006: Sympbol already defined in another library will pick first definition
+		-- LNK4099: Debugging Database file (pdb) missing for given obj
+		-- LNK4098: defaultlib 'library' conflicts with use of other libs; use /NODEFAULTLIB:library
+		linkoptions { "-IGNORE:4006,4099,4098" }
 
-	-- Should use: usestandardpreprocessor 'On', but does not work for some reason. So setting it manualy.
-	buildoptions { "/Zc:preprocessor" }
+		-- Should use: usestandardpreprocessor 'On', but does not work for some reason. So setting it manualy.
+		buildoptions { "/Zc:preprocessor" }
+	filter {}
 
 	-- Platform
 	platforms
@@ -49,6 +58,11 @@ workspace "HLSLVariantLSPServer"
 		}
 		-- Disable C100 Unused parameter
 		disablewarnings { "4100" }
+	filter "options:trace"
+		defines
+		{
+			"MSLP_TRACE",
+		}
 	filter {}
 
 	-- Compiler option
@@ -100,7 +114,7 @@ project "HLSLVServer"
 	objdir ("%{wks.location}/Build/obj/" .. outputdir .. "/%{prj.name}")
 
     -- Files to include
-	files { GetFiles("Src/") }
+	files { GetFiles("src/") }
 
 	ExternalsIncludes()
 	ExternalsLinks()
@@ -110,4 +124,38 @@ project "HLSLVServer"
 		postbuildcommands {"xcopy /y /d %{wks.location}Build\\bin\\" .. outputdir .. "\\%{prj.name}\\%{prj.name}.exe .\\..\\hlslvariant\\bin\\"}
 	filter {}
 
+-- Replays edit traces against the text storages, see benchmark/Benchmark.cpp.
+project "HLSLVBenchmark"
+	kind "ConsoleApp"
+	language "C++"
+
+	-- Targets
+	targetdir ("%{wks.location}/Build/bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("%{wks.location}/Build/obj/" .. outputdir .. "/%{prj.name}")
+
+	-- Counts the bytes the storages copy.
+	defines { "MSLP_STORAGE_STATS" }
+
+	includedirs { "src/" }
+
+	-- Only the storage code, the benchmark does not need the externals.
+	files { "src/TextScan.h", "src/TextScan.cpp", GetFiles("benchmark/") }
+
+-- Replays a session recorded with HLSLVServer --record against the server, see replay/Replay.cpp.
+project "HLSLVReplay"
+	kind "ConsoleApp"
+	language "C++"
+
+	-- Targets
+	targetdir ("%{wks.location}/Build/bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("%{wks.location}/Build/obj/" .. outputdir .. "/%{prj.name}")
+
+	includedirs { "src/" }
+
+	files { GetFiles("replay/") }
+
+	filter "system:linux"
+		links { "pthread" }
+	filter {}
+
 project "*"
\ No newline at end of file
@@ -0,0 +1,317 @@
+// Replays a session recorded with the server's --record option against the server, without an editor:
+//
+//   HLSLVReplay session.lsprec --server=path/to/HLSLVServer [--pacing=fast|original] [--strict] [--timeout=MS] [-- server arguments...]
+//
+// The inbound frames of the recording are sent to a new server process, as fast as it reads them or with the recorded time between them.
+// Each reply is checked against the recorded one: it has to arrive, and has to be a result or an error like the recorded one.
+// --strict also compares the replies' content. Replies that depend on timing (cancelled requests, changed documents) are not compared.
+// Prints the latency of every method from sending the request until the reply arrived and the overall throughput,
+// and exits with 1 if a check failed, so it can run as a regression test.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "SessionRecorder.h"
+#include "MessageFrame.h"
+#include "LatencyHistogram.h"
+#include "ServerProcess.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Returns the raw text of the value of a member of the top level object, e.g. 7 or "textDocument/hover", or an empty view if there is none.
+std::string_view FindMember(std::string_view json, std::string_view key)
+{
+	size_t depth = 0;
+	size_t i = 0;
+	while (i < json.size())
+	{
+		const char c = json[i];
+		if (c == '"')
+		{
+			const size_t start = i;
+			for (++i; i < json.size() && json[i] != '"'; ++i)
+			{
+				if (json[i] == '\\')
+					++i;
+			}
+			++i;
+			if (depth != 1)
+				continue;
+
+			// A key of the top level object if followed by a colon.
+			size_t colon = i;
+			while (colon < json.size() && (json[colon] == ' ' || json[colon] == '\t' || json[colon] == '\r' || json[colon] == '\n'))
+				++colon;
+			if (colon >= json.size() || json[colon] != ':' || json.substr(start + 1, i - start - 2) != key)
+				continue;
+
+			// The value ends at the comma or brace that closes it on this level.
+			size_t valueStart = colon + 1;
+			while (valueStart < json.size() && (json[valueStart] == ' ' || json[valueStart] == '\t' || json[valueStart] == '\r' || json[valueStart] == '\n'))
+				++valueStart;
+			size_t valueDepth = 0;
+			size_t end = valueStart;
+			for (; end < json.size(); ++end)
+			{
+				const char v = json[end];
+				if (v == '"')
+				{
+					for (++end; end < json.size() && json[end] != '"'; ++end)
+					{
+						if (json[end] == '\\')
+							++end;
+					}
+				}
+				else if (v == '{' || v == '[')
+					++valueDepth;
+				else if ((v == '}' || v == ']') && valueDepth-- == 0)
+					break;
+				else if (v == ',' && valueDepth == 0)
+					break;
+			}
+			while (end > valueStart && (json[end - 1] == ' ' || json[end - 1] == '\r' || json[end - 1] == '\n'))
+				--end;
+			return json.substr(valueStart, end - valueStart);
+		}
+
+		if (c == '{' || c == '[')
+			++depth;
+		else if (c == '}' || c == ']')
+			--depth;
+		++i;
+	}
+	return std::string_view();
+}
+
+struct Request
+{
+	std::string method;
+	Clock::time_point sent;
+};
+
+struct Checks
+{
+	size_t replyCount = 0;
+	size_t missingCount = 0;
+	size_t kindMismatchCount = 0;		// A result where an error was recorded, or the other way around.
+	size_t contentMismatchCount = 0;	// --strict only.
+	size_t unexpectedCount = 0;			// Replies to requests that were never sent.
+};
+
+// Replies that depend on timing, e.g. a request that got cancelled before it finished, are not compared.
+bool DependsOnTiming(std::string_view recordedReply)
+{
+	const std::string_view error = FindMember(recordedReply, "error");
+	if (error.empty())
+		return false;
+	const std::string_view code = FindMember(error, "code");
+	return code == "-32800" || code == "-32801" || code == "-32802"; // RequestCancelled, ContentModified, ServerCancelled
+}
+
+int main(int argc, char** argv)
+{
+	std::string recordingPath;
+	std::string serverPath;
+	std::vector<std::string> serverArguments;
+	bool originalPacing = false;
+	bool strict = false;
+	std::chrono::milliseconds timeout(10000);
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string_view arg = argv[i];
+		if (arg == "--")
+		{
+			for (++i; i < argc; ++i)
+				serverArguments.push_back(argv[i]);
+		}
+		else if (arg.starts_with("--server="))
+			serverPath = arg.substr(std::strlen("--server="));
+		else if (arg == "--pacing=original")
+			originalPacing = true;
+		else if (arg == "--pacing=fast")
+			originalPacing = false;
+		else if (arg == "--strict")
+			strict = true;
+		else if (arg.starts_with("--timeout="))
+			timeout = std::chrono::milliseconds(std::strtoll(argv[i] + std::strlen("--timeout="), nullptr, 10));
+		else
+			recordingPath = arg;
+	}
+
+	if (recordingPath.empty() || serverPath.empty())
+	{
+		std::fprintf(stderr, "Usage: HLSLVReplay <recording> --server=<server executable> [--pacing=fast|original] [--strict] [--timeout=MS] [-- server arguments...]\n");
+		return 2;
+	}
+
+	std::vector<SessionRecorder::Frame> frames;
+	if (!SessionRecorder::Read(recordingPath, frames))
+	{
+		std::fprintf(stderr, "Could not read %s\n", recordingPath.c_str());
+		return 2;
+	}
+
+	// Recorded replies by request id.
+	std::unordered_map<std::string, std::string_view> recordedReplies;
+	size_t inboundCount = 0;
+	for (const SessionRecorder::Frame& frame : frames)
+	{
+		const std::string_view body = frame.GetBody();
+		if (frame.direction == SessionRecorder::Direction::In)
+			inboundCount++;
+		else if (FindMember(body, "method").empty() && !FindMember(body, "id").empty())
+			recordedReplies[std::string(FindMember(body, "id"))] = body;
+	}
+
+	ServerProcess server;
+	if (!server.Start(serverPath, serverArguments))
+	{
+		std::fprintf(stderr, "Could not start %s\n", serverPath.c_str());
+		return 2;
+	}
+
+	std::mutex mutex;
+	std::condition_variable repliesArrived;
+	std::unordered_map<std::string, Request> pending;
+	std::map<std::string, std::unique_ptr<LatencyHistogram>> latencies;
+	Checks checks;
+	bool serverExited = false;
+
+	// Sends the inbound frames, then waits for the outstanding replies and ends the connection if the recording did not.
+	const Clock::time_point start = Clock::now();
+	std::thread sender([&]()
+		{
+			bool sentExit = false;
+			uint64_t firstTimeMicros = UINT64_MAX;
+			for (const SessionRecorder::Frame& frame : frames)
+			{
+				if (frame.direction != SessionRecorder::Direction::In)
+					continue;
+				if (firstTimeMicros == UINT64_MAX)
+					firstTimeMicros = frame.timeMicros;
+				if (originalPacing)
+					std::this_thread::sleep_until(start + std::chrono::microseconds(frame.timeMicros - firstTimeMicros));
+
+				const std::string_view body = frame.GetBody();
+				const std::string_view method = FindMember(body, "method");
+				const std::string_view id = FindMember(body, "id");
+				if (!method.empty() && !id.empty())
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					pending[std::string(id)] = Request{ std::string(method.substr(1, method.size() - 2)), Clock::now() };
+				}
+				sentExit |= method == "\"exit\"";
+				if (!server.Write(frame.data.data(), frame.data.size()))
+					break;
+			}
+
+			if (!sentExit)
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				repliesArrived.wait_for(lock, timeout, [&]() { return pending.empty() || serverExited; });
+			}
+			server.CloseInput();
+		});
+
+	// Reads and checks the replies until the server exits.
+	std::string output;
+	size_t frameStart = 0;
+	std::vector<char> buffer(64 * 1024);
+	while (true)
+	{
+		const size_t count = server.Read(buffer.data(), buffer.size());
+		if (count == 0)
+			break;
+		output.append(buffer.data(), count);
+
+		size_t bodyStart;
+		size_t frameEnd;
+		while ((frameEnd = MessageFrame::FindEnd(output, frameStart, bodyStart)) != std::string::npos)
+		{
+			const Clock::time_point now = Clock::now();
+			const std::string_view body = std::string_view(output).substr(bodyStart, frameEnd - bodyStart);
+			frameStart = frameEnd;
+
+			const std::string_view id = FindMember(body, "id");
+			if (id.empty() || !FindMember(body, "method").empty())
+				continue; // Notifications and requests from the server.
+
+			std::lock_guard<std::mutex> lock(mutex);
+			checks.replyCount++;
+			auto it = pending.find(std::string(id));
+			if (it == pending.end())
+			{
+				checks.unexpectedCount++;
+				continue;
+			}
+
+			std::unique_ptr<LatencyHistogram>& pLatency = latencies[it->second.method];
+			if (!pLatency)
+				pLatency = std::make_unique<LatencyHistogram>();
+			pLatency->Record(now - it->second.sent);
+
+			auto recorded = recordedReplies.find(it->first);
+			if (recorded != recordedReplies.end() && !DependsOnTiming(recorded->second))
+			{
+				const bool isError = !FindMember(body, "error").empty();
+				const bool wasError = !FindMember(recorded->second, "error").empty();
+				if (isError != wasError)
+				{
+					checks.kindMismatchCount++;
+					std::fprintf(stderr, "Reply to %s %s: %s, recorded %s\n", it->second.method.c_str(), it->first.c_str(), isError ? "error" : "result", wasError ? "error" : "result");
+				}
+				else if (strict && FindMember(body, isError ? "error" : "result") != FindMember(recorded->second, isError ? "error" : "result"))
+				{
+					checks.contentMismatchCount++;
+					std::fprintf(stderr, "Reply to %s %s differs from the recorded one\n", it->second.method.c_str(), it->first.c_str());
+				}
+			}
+			pending.erase(it);
+			repliesArrived.notify_all();
+		}
+
+		if (frameStart == output.size())
+		{
+			output.clear();
+			frameStart = 0;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		serverExited = true;
+		repliesArrived.notify_all();
+	}
+	sender.join();
+	const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	const int exitCode = server.Wait();
+
+	checks.missingCount = pending.size();
+	for (const auto& [id, request] : pending)
+		std::fprintf(stderr, "No reply to %s %s\n", request.method.c_str(), id.c_str());
+
+	std::printf("%-36s %8s %10s %10s %10s %10s\n", "method", "count", "p50 ms", "p99 ms", "p999 ms", "max ms");
+	for (const auto& [method, pLatency] : latencies)
+	{
+		std::printf("%-36s %8llu %10.3f %10.3f %10.3f %10.3f\n", method.c_str(), (unsigned long long)pLatency->GetCount(),
+			LatencyHistogram::ToMicroseconds(pLatency->GetPercentile(0.5)) / 1000.0, LatencyHistogram::ToMicroseconds(pLatency->GetPercentile(0.99)) / 1000.0,
+			LatencyHistogram::ToMicroseconds(pLatency->GetPercentile(0.999)) / 1000.0, LatencyHistogram::ToMicroseconds(pLatency->GetMax()) / 1000.0);
+	}
+	std::printf("%zu messages in %.3f s, %.0f messages/s, %s pacing, server exit code %d\n",
+		inboundCount, seconds, seconds > 0.0 ? (double)inboundCount / seconds : 0.0, originalPacing ? "original" : "fast", exitCode);
+	std::printf("%zu replies, %zu missing, %zu result/error mismatches, %zu content mismatches, %zu unexpected\n",
+		checks.replyCount, checks.missingCount, checks.kindMismatchCount, checks.contentMismatchCount, checks.unexpectedCount);
+
+	const bool passed = checks.missingCount == 0 && checks.kindMismatchCount == 0 && checks.contentMismatchCount == 0 && checks.unexpectedCount == 0;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#ifdef MSLP_PLATFORM_WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+	#include <signal.h>
+	#include <sys/types.h>
+	#include <sys/wait.h>
+#endif
+
+// The language server started as a child process, talking to it over its standard input and output like an editor does.
+struct ServerProcess
+{
+public:
+	ServerProcess() = default;
+	~ServerProcess() { Wait(); }
+
+	ServerProcess(const ServerProcess&) = delete;
+	ServerProcess& operator=(const ServerProcess&) = delete;
+
+	// Returns false if the server could not be started.
+	bool Start(const std::string& path, const std::vector<std::string>& arguments)
+	{
+#ifdef MSLP_PLATFORM_WINDOWS
+		SECURITY_ATTRIBUTES attributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+		HANDLE childInput, childOutput;
+		if (!CreatePipe(&childInput, &m_Input, &attributes, 0) || !CreatePipe(&m_Output, &childOutput, &attributes, 0))
+			return false;
+		SetHandleInformation(m_Input, HANDLE_FLAG_INHERIT, 0);
+		SetHandleInformation(m_Output, HANDLE_FLAG_INHERIT, 0);
+
+		std::string commandLine = "\"" + path + "\"";
+		for (const std::string& argument : arguments)
+			commandLine += " \"" + argument + "\"";
+
+		STARTUPINFOA startupInfo = {};
+		startupInfo.cb = sizeof(startupInfo);
+		startupInfo.dwFlags = STARTF_USESTDHANDLES;
+		startupInfo.hStdInput = childInput;
+		startupInfo.hStdOutput = childOutput;
+		startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+		PROCESS_INFORMATION processInfo = {};
+		const bool started = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startupInfo, &processInfo);
+		CloseHandle(childInput);
+		CloseHandle(childOutput);
+		if (!started)
+			return false;
+		CloseHandle(processInfo.hThread);
+		m_Process = processInfo.hProcess;
+		return true;
+#else
+		int inputPipe[2];
+		int outputPipe[2];
+		if (pipe(inputPipe) != 0 || pipe(outputPipe) != 0)
+			return false;
+
+		std::vector<char*> argv;
+		argv.push_back(const_cast<char*>(path.c_str()));
+		for (const std::string& argument : arguments)
+			argv.push_back(const_cast<char*>(argument.c_str()));
+		argv.push_back(nullptr);
+
+		m_Pid = fork();
+		if (m_Pid < 0)
+			return false;
+		if (m_Pid == 0)
+		{
+			dup2(inputPipe[0], 0);
+			dup2(outputPipe[1], 1);
+			close(inputPipe[0]);
+			close(inputPipe[1]);
+			close(outputPipe[0]);
+			close(outputPipe[1]);
+			execv(path.c_str(), argv.data());
+			_exit(127);
+		}
+
+		close(inputPipe[0]);
+		close(outputPipe[1]);
+		m_Input = inputPipe[1];
+		m_Output = outputPipe[0];
+		signal(SIGPIPE, SIG_IGN); // A server that exits early shows up as a failed write instead.
+		return true;
+#endif
+	}
+
+	// Writes everything to the server's standard input. Returns false if the server is gone.
+	bool Write(const char* pData, size_t count)
+	{
+		while (count > 0)
+		{
+#ifdef MSLP_PLATFORM_WINDOWS
+			DWORD written = 0;
+			if (!WriteFile(m_Input, pData, (DWORD)count, &written, nullptr) || written == 0)
+				return false;
+#else
+			const ssize_t written = ::write(m_Input, pData, count);
+			if (written <= 0)
+				return false;
+#endif
+			pData += written;
+			count -= (size_t)written;
+		}
+		return true;
+	}
+
+	// Reads what the server has written to its standard output, blocking until there is something. Returns 0 once the server has exited.
+	size_t Read(char* pBuffer, size_t capacity)
+	{
+#ifdef MSLP_PLATFORM_WINDOWS
+		DWORD count = 0;
+		if (!ReadFile(m_Output, pBuffer, (DWORD)capacity, &count, nullptr))
+			return 0;
+		return (size_t)count;
+#else
+		const ssize_t count = ::read(m_Output, pBuffer, capacity);
+		return count > 0 ? (size_t)count : 0;
+#endif
+	}
+
+	// Closes the server's standard input, which ends the connection.
+	void CloseInput()
+	{
+#ifdef MSLP_PLATFORM_WINDOWS
+		if (m_Input)
+			CloseHandle(m_Input);
+		m_Input = nullptr;
+#else
+		if (m_Input >= 0)
+			close(m_Input);
+		m_Input = -1;
+#endif
+	}
+
+	// Waits for the server to exit. Returns its exit code.
+	int Wait()
+	{
+		CloseInput();
+#ifdef MSLP_PLATFORM_WINDOWS
+		if (m_Process == nullptr)
+			return m_ExitCode;
+		WaitForSingleObject(m_Process, INFINITE);
+		DWORD exitCode = 0;
+		GetExitCodeProcess(m_Process, &exitCode);
+		m_ExitCode = (int)exitCode;
+		CloseHandle(m_Process);
+		CloseHandle(m_Output);
+		m_Process = nullptr;
+#else
+		if (m_Pid <= 0)
+			return m_ExitCode;
+		int status = 0;
+		waitpid(m_Pid, &status, 0);
+		m_ExitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+		close(m_Output);
+		m_Pid = -1;
+#endif
+		return m_ExitCode;
+	}
+
+private:
+#ifdef MSLP_PLATFORM_WINDOWS
+	HANDLE m_Process = nullptr;
+	HANDLE m_Input = nullptr;
+	HANDLE m_Output = nullptr;
+#else
+	pid_t m_Pid = -1;
+	int m_Input = -1;
+	int m_Output = -1;
+#endif
+	int m_ExitCode = -1;
+};
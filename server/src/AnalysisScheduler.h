@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <functional>
+
+#include "EventLoop.h"
+#include "Trace.h"
+
+// Decides when the expensive work on a document (reparse, diagnostics, semantic tokens) runs.
+// Text edits are applied as they arrive, while the analysis waits until the document has been quiet for the debounce window,
+// so a burst of keystrokes is analyzed once:
+//
+// Edits:     x x x x x           x
+// Analysis:            |-window-|A   |-window-|A
+//
+// Requests that need up to date results call Flush, which runs a pending analysis right away.
+struct AnalysisScheduler
+{
+public:
+	using Analyze = std::function<void(const std::string& uri)>;
+
+	// analyze: Called on the message thread with the URI of the document to analyze.
+	AnalysisScheduler(EventLoop& loop, std::chrono::milliseconds debounce, Analyze analyze)
+		: m_Loop(loop), m_Debounce(debounce), m_Analyze(std::move(analyze)) {}
+
+	// The document changed, (re)starts its debounce window.
+	void OnChanged(const std::string& uri)
+	{
+		if (m_Debounce.count() <= 0)
+		{
+			Run(uri);
+			return;
+		}
+		m_Loop.SetTimer(GetTimerKey(uri), m_Debounce, [this, uri]() { Run(uri); });
+	}
+
+	// Runs the pending analysis of the document now. Returns false if none was pending.
+	bool Flush(const std::string& uri) { return m_Loop.RunTimer(GetTimerKey(uri)); }
+
+	// Drops the pending analysis, for documents that were closed.
+	void Cancel(const std::string& uri) { m_Loop.CancelTimer(GetTimerKey(uri)); }
+
+private:
+	void Run(const std::string& uri)
+	{
+		MSLP_TRACE_ZONE("Analyze");
+		m_Analyze(uri);
+	}
+
+	// Other users of the event loop have their own timers, keep the keys apart.
+	static std::string GetTimerKey(const std::string& uri) { return "analyze:" + uri; }
+
+private:
+	EventLoop& m_Loop;
+	const std::chrono::milliseconds m_Debounce;
+	Analyze m_Analyze;
+};
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+#include "TextStorage.h"
+#include "LineIndex.h"
+#include "TreeChanges.h"
+#include "TreeWalk.h"
+#include "Trace.h"
+
+// The tree of a document flattened into arrays, one entry per node, for analysis passes that scan it linearly instead of asking tree-sitter
+// for every field of every node. Only named nodes and keywords are kept, punctuation is left out.
+//
+// The nodes are in pre-order: the root is at 0, followed by the top-level items (functions, cbuffers, declarations, ...), each with its subtree after it.
+// After a reparse only the items that overlap the lines that changed (see TreeChanges) are walked again, the others are copied and moved along with the edits.
+struct AstSnapshot
+{
+public:
+	// No parent, child or sibling.
+	inline static constexpr uint32_t m_sNone = UINT32_MAX;
+
+	bool IsBuilt() const { return m_Built; }
+
+	void Clear()
+	{
+		m_Built = false;
+		ClearNodes(m_Nodes);
+		m_Items.clear();
+		m_Identifiers.clear();
+		m_IdentifierIds.clear();
+	}
+
+	// Walks the whole tree. Identifiers get new ids.
+	void Build(TSNode root, const TextStorage& storage)
+	{
+		MSLP_TRACE_ZONE("AST snapshot");
+		Clear();
+		Nodes nodes;
+		std::vector<Item> items;
+		AddRoot(root, nodes);
+		TSTreeCursor cursor = ts_tree_cursor_new(root);
+		if (ts_tree_cursor_goto_first_child(&cursor))
+		{
+			do
+			{
+				const TSNode child = ts_tree_cursor_current_node(&cursor);
+				if (IsKept(child))
+					items.push_back(BuildItem(child, storage, nodes));
+			} while (ts_tree_cursor_goto_next_sibling(&cursor));
+		}
+		ts_tree_cursor_delete(&cursor);
+		LinkItems(items, nodes);
+
+		m_Nodes = std::move(nodes);
+		m_Items = std::move(items);
+		m_Built = true;
+	}
+
+	// Brings the snapshot up to date with a new tree. Indices of nodes change, ids of identifiers only when the names no node has any more are dropped.
+	// edits: Applied to the old tree since the snapshot was last updated, in order.
+	// pChangedRanges: From ts_tree_get_changed_ranges between the old and the new tree.
+	void Update(TSNode root, const TextStorage& storage, const LineIndex& lines, const std::vector<TSInputEdit>& edits, const TSRange* pChangedRanges, uint32_t changedRangeCount)
+	{
+		if (!m_Built)
+			return;
+		MSLP_TRACE_ZONE("AST snapshot");
+
+		// Where the old items are in the new text. The nodes in an item are moved when it is copied, no edit falls inside an item that is not walked again.
+		for (const TSInputEdit& edit : edits)
+		{
+			for (Item& item : m_Items)
+			{
+				item.startByte = TreeChanges::MoveOffset(item.startByte, edit);
+				item.endByte = TreeChanges::MoveOffset(item.endByte, edit, true);
+			}
+		}
+
+		const std::vector<TreeChanges::Span> spans = TreeChanges::GetChangedLines(lines, edits, pChangedRanges, changedRangeCount);
+		if (spans.empty())
+			return;
+
+		Nodes nodes;
+		nodes.Reserve(m_Nodes.kinds.size());
+		std::vector<Item> items;
+		items.reserve(m_Items.size());
+		AddRoot(root, nodes);
+		size_t span = 0;
+		size_t oldItem = 0;
+		TSTreeCursor cursor = ts_tree_cursor_new(root);
+		if (ts_tree_cursor_goto_first_child(&cursor))
+		{
+			do
+			{
+				const TSNode child = ts_tree_cursor_current_node(&cursor);
+				if (!IsKept(child))
+					continue;
+				const uint32_t startByte = ts_node_start_byte(child);
+				const uint32_t endByte = ts_node_end_byte(child);
+
+				while (span < spans.size() && spans[span].end <= startByte)
+					span++;
+				const bool changed = span < spans.size() && spans[span].start <= endByte;
+
+				while (oldItem < m_Items.size() && m_Items[oldItem].startByte < startByte)
+					oldItem++;
+				const NodeKind kind = NodeKindTable::Get().GetKind(child);
+				if (!changed && oldItem < m_Items.size() && m_Items[oldItem].startByte == startByte && m_Items[oldItem].endByte == endByte && m_Nodes.kinds[m_Items[oldItem].first] == kind)
+					items.push_back(CopyItem(m_Items[oldItem], nodes));
+				else
+					items.push_back(BuildItem(child, storage, nodes));
+			} while (ts_tree_cursor_goto_next_sibling(&cursor));
+		}
+		ts_tree_cursor_delete(&cursor);
+		LinkItems(items, nodes);
+
+		m_Nodes = std::move(nodes);
+		m_Items = std::move(items);
+		if (m_Identifiers.size() > m_sMinCompactCount)
+			CompactIdentifiers();
+	}
+
+	uint32_t GetCount() const { return (uint32_t)m_Nodes.kinds.size(); }
+
+	// Indexed by node, for linear scans.
+	const std::vector<NodeKind>& GetKinds() const { return m_Nodes.kinds; }
+	const std::vector<uint32_t>& GetParents() const { return m_Nodes.parents; }
+	const std::vector<uint32_t>& GetFirstChildren() const { return m_Nodes.firstChildren; }
+	const std::vector<uint32_t>& GetNextSiblings() const { return m_Nodes.nextSiblings; }
+	const std::vector<uint32_t>& GetStartBytes() const { return m_Nodes.startBytes; }
+	const std::vector<uint32_t>& GetEndBytes() const { return m_Nodes.endBytes; }
+	// The id of the name of identifier nodes (identifier, type_identifier, field_identifier, ...), 0 for the other nodes.
+	const std::vector<uint32_t>& GetIdentifiers() const { return m_Nodes.identifiers; }
+
+	std::string_view GetIdentifierName(uint32_t id) const { return id > 0 && id <= m_Identifiers.size() ? std::string_view(m_Identifiers[id - 1]) : std::string_view(); }
+
+	// 0 if no node has the name.
+	uint32_t FindIdentifier(std::string_view name) const
+	{
+		auto it = m_IdentifierIds.find(name);
+		return it != m_IdentifierIds.end() ? it->second : 0;
+	}
+
+private:
+	struct Nodes
+	{
+		std::vector<NodeKind> kinds;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> firstChildren;
+		std::vector<uint32_t> nextSiblings;
+		std::vector<uint32_t> startBytes;
+		std::vector<uint32_t> endBytes;
+		std::vector<uint32_t> identifiers;
+
+		void Reserve(size_t count)
+		{
+			kinds.reserve(count);
+			parents.reserve(count);
+			firstChildren.reserve(count);
+			nextSiblings.reserve(count);
+			startBytes.reserve(count);
+			endBytes.reserve(count);
+			identifiers.reserve(count);
+		}
+
+		uint32_t Add(NodeKind kind, uint32_t parent, uint32_t startByte, uint32_t endByte, uint32_t identifier)
+		{
+			kinds.push_back(kind);
+			parents.push_back(parent);
+			firstChildren.push_back(m_sNone);
+			nextSiblings.push_back(m_sNone);
+			startBytes.push_back(startByte);
+			endBytes.push_back(endByte);
+			identifiers.push_back(identifier);
+			return (uint32_t)kinds.size() - 1;
+		}
+	};
+
+	// A top-level item and its subtree, at [first, first + count) in the arrays.
+	struct Item
+	{
+		uint32_t first;
+		uint32_t count;
+		uint32_t startByte;	// Moved along with the edits, the nodes keep the offsets they were added with until the item is copied.
+		uint32_t endByte;
+	};
+
+	// Adds the nodes it visits to the arrays, linking each one to its parent and its previous sibling.
+	struct BuildVisitor
+	{
+		using Kinds = TreeWalk::KindList<>;
+
+		AstSnapshot& snapshot;
+		const TextStorage& storage;
+		Nodes& nodes;
+		std::vector<uint32_t>& path;		// The node at each depth above the visited one.
+		std::vector<uint32_t>& lastChildren;	// The last child added to the node at each depth.
+
+		TreeWalk::Action Default(const TreeWalk::Node& node)
+		{
+			if (!IsKept(node.node, node.kind))
+				return TreeWalk::Action::SkipChildren;
+
+			const uint32_t depth = node.GetDepth();
+			const uint32_t parent = depth > 0 ? path[depth - 1] : 0;
+			const uint32_t index = nodes.Add(node.kind, parent, node.startByte, node.endByte, IsIdentifier(node.kind) ? snapshot.Intern(storage, node.startByte, node.endByte) : 0);
+			if (depth > 0)
+			{
+				if (lastChildren[depth - 1] == m_sNone)
+					nodes.firstChildren[parent] = index;
+				else
+					nodes.nextSiblings[lastChildren[depth - 1]] = index;
+				lastChildren[depth - 1] = index;
+			}
+
+			if (path.size() <= depth)
+			{
+				path.resize(depth + 1);
+				lastChildren.resize(depth + 1);
+			}
+			path[depth] = index;
+			lastChildren[depth] = m_sNone;
+			return TreeWalk::Action::Children;
+		}
+	};
+
+	static bool IsKept(TSNode node, NodeKind kind) { return kind != NodeKind::Unknown || ts_node_is_named(node); }
+	static bool IsKept(TSNode node) { return IsKept(node, NodeKindTable::Get().GetKind(node)); }
+
+	static bool IsIdentifier(NodeKind kind)
+	{
+		return kind == NodeKind::Identifier || kind == NodeKind::TypeIdentifier || kind == NodeKind::FieldIdentifier || kind == NodeKind::NamespaceIdentifier || kind == NodeKind::StatementIdentifier;
+	}
+
+	static void ClearNodes(Nodes& nodes)
+	{
+		nodes.kinds.clear();
+		nodes.parents.clear();
+		nodes.firstChildren.clear();
+		nodes.nextSiblings.clear();
+		nodes.startBytes.clear();
+		nodes.endBytes.clear();
+		nodes.identifiers.clear();
+	}
+
+	static void AddRoot(TSNode root, Nodes& nodes)
+	{
+		nodes.Add(NodeKindTable::Get().GetKind(root), m_sNone, ts_node_start_byte(root), ts_node_end_byte(root), 0);
+	}
+
+	Item BuildItem(TSNode node, const TextStorage& storage, Nodes& nodes)
+	{
+		const uint32_t first = (uint32_t)nodes.kinds.size();
+		BuildVisitor visitor{ *this, storage, nodes, m_Path, m_LastChildren };
+		TreeWalk::Walk(node, visitor);
+		return Item{ first, (uint32_t)nodes.kinds.size() - first, ts_node_start_byte(node), ts_node_end_byte(node) };
+	}
+
+	// Copies an item of the old arrays to the end of the new ones, moving its indices and offsets.
+	Item CopyItem(const Item& item, Nodes& nodes) const
+	{
+		const uint32_t first = (uint32_t)nodes.kinds.size();
+		const uint32_t indexShift = first - item.first;
+		const uint32_t byteShift = item.startByte - m_Nodes.startBytes[item.first];
+		const auto moveIndex = [indexShift](uint32_t index) { return index == m_sNone ? m_sNone : index + indexShift; };
+		for (uint32_t i = item.first; i < item.first + item.count; ++i)
+		{
+			nodes.kinds.push_back(m_Nodes.kinds[i]);
+			nodes.parents.push_back(i == item.first ? 0 : moveIndex(m_Nodes.parents[i]));
+			nodes.firstChildren.push_back(moveIndex(m_Nodes.firstChildren[i]));
+			nodes.nextSiblings.push_back(i == item.first ? m_sNone : moveIndex(m_Nodes.nextSiblings[i]));
+			nodes.startBytes.push_back(m_Nodes.startBytes[i] + byteShift);
+			nodes.endBytes.push_back(m_Nodes.endBytes[i] + byteShift);
+			nodes.identifiers.push_back(m_Nodes.identifiers[i]);
+		}
+		return Item{ first, item.count, item.startByte, item.endByte };
+	}
+
+	// Links the items as the children of the root.
+	static void LinkItems(const std::vector<Item>& items, Nodes& nodes)
+	{
+		for (size_t i = 0; i < items.size(); ++i)
+			nodes.nextSiblings[items[i].first] = i + 1 < items.size() ? items[i + 1].first : m_sNone;
+		nodes.firstChildren[0] = items.empty() ? m_sNone : items[0].first;
+	}
+
+	// Drops the names no node has any more, once they are more than half of them: every name typed on the way to the final one
+	// (f, fo, foo) is interned, so without it the table grows for as long as the document is edited. Gives the names that are left new ids.
+	void CompactIdentifiers()
+	{
+		std::vector<uint32_t> newIds(m_Identifiers.size() + 1, 0);
+		uint32_t liveCount = 0;
+		for (uint32_t id : m_Nodes.identifiers)
+		{
+			if (id != 0 && newIds[id] == 0)
+				newIds[id] = ++liveCount;
+		}
+		if (m_Identifiers.size() <= (size_t)liveCount * 2)
+			return;
+
+		// The map has views of the names that are moved.
+		m_IdentifierIds.clear();
+		std::deque<std::string> identifiers(liveCount);
+		for (uint32_t id = 1; id <= m_Identifiers.size(); ++id)
+		{
+			if (newIds[id] != 0)
+				identifiers[newIds[id] - 1] = std::move(m_Identifiers[id - 1]);
+		}
+		for (uint32_t& id : m_Nodes.identifiers)
+			id = newIds[id];
+
+		m_Identifiers = std::move(identifiers);
+		for (uint32_t id = 1; id <= m_Identifiers.size(); ++id)
+			m_IdentifierIds.emplace(m_Identifiers[id - 1], id);
+	}
+
+	uint32_t Intern(const TextStorage& storage, uint32_t startByte, uint32_t endByte)
+	{
+		m_Name.clear();
+		const TextStorage::Type* pChunk = nullptr;
+		for (size_t offset = startByte; offset < endByte;)
+		{
+			size_t chunkCount = storage.GetChunk(offset, pChunk);
+			if (chunkCount == 0)
+				break;
+			chunkCount = std::min(chunkCount, endByte - offset);
+			m_Name.append((const char*)pChunk, chunkCount);
+			offset += chunkCount;
+		}
+
+		auto it = m_IdentifierIds.find(m_Name);
+		if (it != m_IdentifierIds.end())
+			return it->second;
+		m_Identifiers.push_back(m_Name);
+		const uint32_t id = (uint32_t)m_Identifiers.size();
+		m_IdentifierIds.emplace(m_Identifiers.back(), id);
+		return id;
+	}
+
+private:
+	bool m_Built = false;
+	Nodes m_Nodes;
+	std::vector<Item> m_Items;	// Sorted by start.
+
+	inline static constexpr size_t m_sMinCompactCount = 1024; // Not worth compacting fewer names.
+
+	// Names of the identifiers, the id is the index + 1. Dropped by Build, and by an update that leaves most of them unused (see CompactIdentifiers).
+	std::deque<std::string> m_Identifiers;
+	std::unordered_map<std::string_view, uint32_t> m_IdentifierIds;	// Views of m_Identifiers, a deque does not move its elements.
+
+	// Reused while building.
+	std::vector<uint32_t> m_Path;
+	std::vector<uint32_t> m_LastChildren;
+	std::string m_Name;
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <deque>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+
+#ifdef MSLP_PLATFORM_WINDOWS
+	#include <io.h>
+	#include <fcntl.h>
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <unistd.h>
+	#include <poll.h>
+#endif
+
+#include "EventLoop.h"
+#include "MessageFrame.h"
+#include "SessionRecorder.h"
+#include "Trace.h"
+
+// Standard input read on a thread of its own, so the message thread can run the event loop while it waits for the next message.
+// The reader thread splits the input into JSON-RPC frames and posts each complete frame to the event loop,
+// the stream hands them out on the message thread:
+//
+// stdin --> [ reader thread ] --Post(frame)--> [ event loop ] --> AsyncInputStream --> lsp::Connection
+//
+// Since only whole frames are handed out, the event loop only runs between messages and never while one is half read.
+struct AsyncInputBuffer : public std::streambuf
+{
+public:
+	// pRecorder: Records every frame that arrives if not nullptr, see --record.
+	AsyncInputBuffer(EventLoop& loop, SessionRecorder* pRecorder = nullptr) : m_Loop(loop), m_pRecorder(pRecorder)
+	{
+#ifdef MSLP_PLATFORM_WINDOWS
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+#ifndef MSLP_PLATFORM_WINDOWS
+		// Written to by the destructor to wake the reader thread up from waiting for input.
+		if (pipe(m_WakePipe) != 0)
+			m_WakePipe[0] = m_WakePipe[1] = -1;
+#endif
+		m_Reader = std::thread(&AsyncInputBuffer::Read, this);
+	}
+
+	// The reader thread writes to the buffer and posts to the event loop, so it is stopped before either goes away,
+	// even if the client has not closed the input yet.
+	~AsyncInputBuffer()
+	{
+		m_Stopping.store(true, std::memory_order_release);
+#ifdef MSLP_PLATFORM_WINDOWS
+		// A cancel that comes before the thread is in a read is missed, so it is repeated until the thread is done.
+		while (!m_ReaderDone.load(std::memory_order_acquire))
+		{
+			CancelSynchronousIo(m_Reader.native_handle());
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+#else
+		if (m_WakePipe[1] >= 0)
+		{
+			const char wake = 0;
+			while (write(m_WakePipe[1], &wake, 1) < 0 && errno == EINTR) {}
+		}
+#endif
+		m_Reader.join();
+#ifndef MSLP_PLATFORM_WINDOWS
+		if (m_WakePipe[0] >= 0)
+		{
+			close(m_WakePipe[0]);
+			close(m_WakePipe[1]);
+		}
+#endif
+	}
+
+	AsyncInputBuffer(const AsyncInputBuffer&) = delete;
+	AsyncInputBuffer& operator=(const AsyncInputBuffer&) = delete;
+
+	// When the last message read from the stream was completely received, to tell how long it waited before it was handled.
+	std::chrono::steady_clock::time_point GetArrivalTime()
+	{
+		const size_t position = m_CurrentStart + (size_t)(gptr() - eback());
+		while (!m_Arrivals.empty() && m_Arrivals.front().end <= position)
+		{
+			m_LastArrival = m_Arrivals.front().time;
+			m_Arrivals.pop_front();
+		}
+		return m_LastArrival;
+	}
+
+protected:
+	// Runs the event loop until more input has arrived.
+	int_type underflow() override
+	{
+		if (gptr() < egptr())
+			return traits_type::to_int_type(*gptr());
+
+#ifdef MSLP_TRACE
+		// From handing out the frames until the stream asks for more covers decoding, handling and replying to them.
+		if (m_HandedOutNs != 0)
+			Trace::Record("Messages", m_HandedOutNs, Trace::GetTimeNs());
+#endif
+
+		m_CurrentStart += m_Current.size();
+		m_Current.clear();
+		m_Loop.RunUntil([this]() { return !m_Pending.empty() || m_EndOfInput; });
+		if (m_Pending.empty())
+			return traits_type::eof();
+
+		m_Current.swap(m_Pending);
+		setg(m_Current.data(), m_Current.data(), m_Current.data() + m_Current.size());
+#ifdef MSLP_TRACE
+		m_HandedOutNs = Trace::GetTimeNs();
+#endif
+		return traits_type::to_int_type(*gptr());
+	}
+
+private:
+	void Read()
+	{
+		MSLP_TRACE_THREAD("Reader");
+		ReadFrames();
+		m_ReaderDone.store(true, std::memory_order_release);
+	}
+
+	void ReadFrames()
+	{
+		std::string input;
+		size_t frameStart = 0;
+		char buffer[m_sReadSize];
+		while (true)
+		{
+#ifdef MSLP_PLATFORM_WINDOWS
+			const int count = _read(0, buffer, (unsigned int)m_sReadSize);
+#else
+			if (!WaitForInput())
+				return;
+			const ssize_t count = ::read(0, buffer, m_sReadSize);
+#endif
+			if (m_Stopping.load(std::memory_order_acquire))
+				return; // The buffer and the event loop are going away.
+			if (count <= 0)
+			{
+				// Whatever is left is an incomplete frame, the connection reports the error.
+				m_Loop.Post([this, rest = input.substr(frameStart)]() { m_Pending += rest; m_EndOfInput = true; });
+				return;
+			}
+			input.append(buffer, (size_t)count);
+
+			size_t frameEnd;
+			while ((frameEnd = MessageFrame::FindEnd(input, frameStart)) != std::string::npos)
+			{
+				if (m_pRecorder)
+					m_pRecorder->Record(SessionRecorder::Direction::In, std::string_view(input).substr(frameStart, frameEnd - frameStart));
+				m_Loop.Post([this, frame = input.substr(frameStart, frameEnd - frameStart), arrival = std::chrono::steady_clock::now()]()
+					{
+						m_Pending += frame;
+						m_ReceivedCount += frame.size();
+						m_Arrivals.push_back(Arrival{ m_ReceivedCount, arrival });
+					});
+				frameStart = frameEnd;
+			}
+
+			// Keep the buffer from growing with everything ever read.
+			if (frameStart > 0 && frameStart == input.size())
+			{
+				input.clear();
+				frameStart = 0;
+			}
+			else if (frameStart > m_sReadSize)
+			{
+				input.erase(0, frameStart);
+				frameStart = 0;
+			}
+		}
+	}
+
+#ifndef MSLP_PLATFORM_WINDOWS
+	// Waits until the input can be read without blocking. Returns false if the buffer is being destroyed.
+	bool WaitForInput()
+	{
+		pollfd fds[2] = { { 0, POLLIN, 0 }, { m_WakePipe[0], POLLIN, 0 } };
+		const bool canWake = m_WakePipe[0] >= 0;
+		while (true)
+		{
+			// Without a wake pipe the flag is checked now and then instead.
+			const int result = poll(fds, canWake ? 2 : 1, canWake ? -1 : 100);
+			if (m_Stopping.load(std::memory_order_acquire))
+				return false;
+			if (result > 0 && fds[0].revents != 0)
+				return true; // Input, end of input or an error, the read tells which.
+			if (result < 0 && errno != EINTR)
+				return true;
+		}
+	}
+#endif
+
+private:
+	struct Arrival
+	{
+		size_t end; // Offset in the stream of the end of the frame.
+		std::chrono::steady_clock::time_point time;
+	};
+
+private:
+	inline static constexpr size_t m_sReadSize = 64 * 1024;
+
+	EventLoop& m_Loop;
+	SessionRecorder* m_pRecorder;
+	std::thread m_Reader;
+	std::atomic<bool> m_Stopping = false;
+	std::atomic<bool> m_ReaderDone = false;
+#ifndef MSLP_PLATFORM_WINDOWS
+	int m_WakePipe[2] = { -1, -1 };
+#endif
+
+	// Only used on the message thread.
+	std::string m_Pending;	// Arrived since the last underflow.
+	std::string m_Current;	// Being read by the stream.
+	bool m_EndOfInput = false;
+	size_t m_ReceivedCount = 0;	// Offset in the stream of the end of m_Pending.
+	size_t m_CurrentStart = 0;	// Offset in the stream of the start of m_Current.
+	std::deque<Arrival> m_Arrivals;
+	std::chrono::steady_clock::time_point m_LastArrival = std::chrono::steady_clock::now();
+#ifdef MSLP_TRACE
+	uint64_t m_HandedOutNs = 0;
+#endif
+};
+
+struct AsyncInputStream : public std::istream
+{
+public:
+	AsyncInputStream(EventLoop& loop, SessionRecorder* pRecorder = nullptr) : std::istream(nullptr), m_Buffer(loop, pRecorder)
+	{
+		rdbuf(&m_Buffer);
+	}
+
+	std::chrono::steady_clock::time_point GetArrivalTime() { return m_Buffer.GetArrivalTime(); }
+
+private:
+	AsyncInputBuffer m_Buffer;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdio>
+
+#ifdef MSLP_PLATFORM_WINDOWS
+	#include <io.h>
+	#include <fcntl.h>
+#else
+	#include <unistd.h>
+#endif
+
+#include "OutboundQueue.h"
+#include "SessionRecorder.h"
+#include "Trace.h"
+
+// Standard output written on a thread of its own, so handlers never wait for the client to read what they send.
+// What is written to the stream is collected until it is flushed, which lsp::Connection does after every message,
+// and then queued for the writer thread. The writer sends everything that was queued in the meantime with a single write:
+//
+// lsp::Connection --> AsyncOutputStream --Push--> [ OutboundQueue ] --> [ writer thread ] --> stdout
+// Send(frame) ----------------------------------^
+struct AsyncOutputBuffer : public std::streambuf
+{
+public:
+	// pRecorder: Records every frame that is written if not nullptr, see --record.
+	AsyncOutputBuffer(SessionRecorder* pRecorder = nullptr) : m_pRecorder(pRecorder)
+	{
+#ifdef MSLP_PLATFORM_WINDOWS
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		m_Writer = std::thread(&AsyncOutputBuffer::Write, this);
+	}
+
+	// Sends what is still queued before returning.
+	~AsyncOutputBuffer()
+	{
+		sync();
+		m_Queue.Push(std::string()); // Stops the writer once everything before it has been written.
+		m_Writer.join();
+	}
+
+	AsyncOutputBuffer(const AsyncOutputBuffer&) = delete;
+	AsyncOutputBuffer& operator=(const AsyncOutputBuffer&) = delete;
+
+	// Queues a complete message, header included. Can be called from any thread.
+	void Send(std::string frame)
+	{
+		if (!frame.empty())
+			m_Queue.Push(std::move(frame));
+	}
+
+	// Called on the thread that wrote a message through the stream, once it has been queued.
+	// Note: Set before messages are written.
+	void SetOnMessage(std::function<void()> onMessage) { m_OnMessage = std::move(onMessage); }
+
+	// Number of messages written and the write calls it took.
+	size_t GetMessageCount() const { return m_MessageCount.load(std::memory_order_relaxed); }
+	size_t GetWriteCount() const { return m_WriteCount.load(std::memory_order_relaxed); }
+
+protected:
+	// Note: Only one thread may write through the stream at a time, lsp::Connection writes each message under its own lock.
+	int_type overflow(int_type c) override
+	{
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+			m_Current.push_back(traits_type::to_char_type(c));
+		return traits_type::not_eof(c);
+	}
+
+	std::streamsize xsputn(const char_type* pData, std::streamsize count) override
+	{
+		m_Current.append(pData, (size_t)count);
+		return count;
+	}
+
+	int sync() override
+	{
+		if (!m_Current.empty())
+		{
+			m_Queue.Push(std::move(m_Current));
+			m_Current = std::string();
+			if (m_OnMessage)
+				m_OnMessage();
+		}
+		return 0;
+	}
+
+private:
+	void Write()
+	{
+		MSLP_TRACE_THREAD("Writer");
+		std::string batch;
+		bool stop = false;
+		while (!stop)
+		{
+			OutboundQueue::Message* pMessages = m_Queue.TakeAll();
+			MSLP_TRACE_ZONE("Write");
+
+			batch.clear();
+			size_t messageCount = 0;
+			for (OutboundQueue::Message* pMessage = pMessages; pMessage; pMessage = pMessage->pNext)
+			{
+				if (pMessage->data.empty())
+				{
+					stop = true;
+					break;
+				}
+				batch += pMessage->data;
+				if (m_pRecorder)
+					m_pRecorder->Record(SessionRecorder::Direction::Out, pMessage->data);
+				messageCount++;
+			}
+			OutboundQueue::Delete(pMessages);
+
+			WriteAll(batch.data(), batch.size());
+			m_MessageCount.fetch_add(messageCount, std::memory_order_relaxed);
+
+			// Do not hold on to the memory of one very large message.
+			if (batch.capacity() > m_sMaxKeptBatchCapacity)
+				batch = std::string();
+		}
+	}
+
+	void WriteAll(const char* pData, size_t count)
+	{
+		while (count > 0)
+		{
+#ifdef MSLP_PLATFORM_WINDOWS
+			const int written = _write(1, pData, (unsigned int)count);
+#else
+			const ssize_t written = ::write(1, pData, count);
+#endif
+			m_WriteCount.fetch_add(1, std::memory_order_relaxed);
+			if (written <= 0)
+				return; // The client is gone, the reader will see the end of the input.
+			pData += written;
+			count -= (size_t)written;
+		}
+	}
+
+private:
+	inline static constexpr size_t m_sMaxKeptBatchCapacity = 1u << 20;
+
+	SessionRecorder* m_pRecorder;
+	OutboundQueue m_Queue;
+	std::thread m_Writer;
+	std::string m_Current; // The message being written through the stream.
+	std::function<void()> m_OnMessage;
+
+	std::atomic<size_t> m_MessageCount = 0;
+	std::atomic<size_t> m_WriteCount = 0;
+};
+
+struct AsyncOutputStream : public std::ostream
+{
+public:
+	AsyncOutputStream(SessionRecorder* pRecorder = nullptr) : std::ostream(nullptr), m_Buffer(pRecorder)
+	{
+		rdbuf(&m_Buffer);
+	}
+
+	void Send(std::string frame) { m_Buffer.Send(std::move(frame)); }
+	AsyncOutputBuffer& GetBuffer() { return m_Buffer; }
+
+private:
+	AsyncOutputBuffer m_Buffer;
+};
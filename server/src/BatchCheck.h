@@ -0,0 +1,220 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <chrono>
+#include <format>
+
+#include "Document.h"
+#include "ParseWorkerPool.h"
+#include "Diagnostics.h"
+#include "JsonEscape.h"
+
+// HLSLVServer --check <dir>: Checks every .hlslv file under the directory without an editor, for build machines.
+// The files are parsed on the same worker pool and checked with the same analysis as open documents, one worker per core.
+// Diagnostics are printed sorted by file, either like a compiler does or as one JSON document:
+//
+// shaders/lit.hlslv:12:5: error: Missing ;
+//
+// {"files":120,"errors":1,"diagnostics":[{"file":"shaders/lit.hlslv","line":12,"column":5,"endLine":12,"endColumn":5,"severity":"error","message":"Missing ;"}]}
+//
+// Lines and columns start at 1, columns count bytes.
+struct BatchCheck
+{
+public:
+	struct Options
+	{
+		std::string directory;
+		bool json = false;
+		size_t threadCount = 0;			// 0 for one per core.
+		uint64_t timeoutMicros = 0;		// Parses that take longer are reported as an error. 0 for no limit.
+		TextStorageKind storageKind = TextStorageKind::Auto;
+	};
+
+	// Returns the exit code of the process: 0 if no errors were found, 1 if there were, 2 if the directory could not be read.
+	static int Run(const TSLanguage* pLanguage, const Options& options, std::ostream& out)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		std::error_code error;
+		if (!std::filesystem::is_directory(options.directory, error))
+		{
+			std::cerr << std::format("{} is not a directory\n", options.directory);
+			return 2;
+		}
+
+		std::vector<std::string> paths;
+		for (auto it = std::filesystem::recursive_directory_iterator(options.directory, std::filesystem::directory_options::skip_permission_denied, error);
+			it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+		{
+			if (it->is_regular_file(error) && it->path().extension() == ".hlslv")
+				paths.push_back(it->path().generic_string());
+		}
+		std::sort(paths.begin(), paths.end());
+
+		std::vector<FileReport> reports = Check(pLanguage, options, paths);
+
+		size_t errorCount = 0;
+		for (const FileReport& report : reports)
+			for (const Entry& entry : report.entries)
+				errorCount += entry.severity == DiagnosticSeverity::Error ? 1 : 0;
+
+		if (options.json)
+			WriteJson(out, reports, errorCount);
+		else
+		{
+			WriteText(out, reports);
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			out << std::format("Checked {} files in {:.2f} s, {} errors\n", reports.size(), seconds, errorCount);
+		}
+		return errorCount > 0 ? 1 : 0;
+	}
+
+private:
+	// A diagnostic with its position worked out.
+	struct Entry
+	{
+		uint32_t line;
+		uint32_t column;
+		uint32_t endLine;
+		uint32_t endColumn;
+		DiagnosticSeverity severity;
+		std::string message;
+	};
+
+	struct FileReport
+	{
+		std::string path;
+		std::vector<Entry> entries;
+	};
+
+	static std::vector<FileReport> Check(const TSLanguage* pLanguage, const Options& options, const std::vector<std::string>& paths)
+	{
+		std::vector<FileReport> reports(paths.size());
+		std::unordered_map<std::string, size_t> indices;
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			reports[i].path = paths[i];
+			indices[paths[i]] = i;
+		}
+
+		std::mutex mutex;
+		std::condition_variable resultReady;
+		size_t readyCount = 0;
+		const size_t threadCount = options.threadCount > 0 ? options.threadCount : std::max<size_t>(1, std::thread::hardware_concurrency());
+		ParseWorkerPool parsers(pLanguage, threadCount, options.timeoutMicros, [&mutex, &resultReady, &readyCount]()
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				readyCount++;
+				resultReady.notify_one();
+			});
+
+		// Files are read while the workers parse, with a few queued per worker so they never wait and not every file is in memory at once.
+		const size_t maxInFlight = threadCount * 4;
+		size_t inFlight = 0;
+		size_t next = 0;
+		while (next < paths.size() || inFlight > 0)
+		{
+			while (next < paths.size() && inFlight < maxInFlight)
+			{
+				const std::string& path = paths[next++];
+				std::string text;
+				if (!ReadFile(path, text))
+				{
+					reports[indices[path]].entries.push_back(Entry{ 1, 1, 1, 1, DiagnosticSeverity::Error, "Could not read the file" });
+					continue;
+				}
+
+				// The URI is only used to tell documents apart.
+				Document document(path, 0, text, options.storageKind, PositionEncoding::UTF8);
+				parsers.Dispatch(document.GetSnapshot(), nullptr);
+				inFlight++;
+			}
+
+			if (inFlight == 0)
+				continue; // The rest of the files could not be read.
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				resultReady.wait(lock, [&readyCount]() { return readyCount > 0; });
+				readyCount = 0;
+			}
+			parsers.PollResults([&](ParseResult&& result)
+				{
+					inFlight--;
+					FileReport& report = reports[indices[result.pSnapshot->GetUri()]];
+					if (result.pTree == nullptr)
+					{
+						report.entries.push_back(Entry{ 1, 1, 1, 1, DiagnosticSeverity::Error, std::format("Parsing took longer than {} ms", options.timeoutMicros / 1000) });
+						return;
+					}
+
+					std::vector<Diagnostic> diagnostics;
+					Diagnostics::CollectSyntaxErrors(ts_tree_root_node(result.pTree), diagnostics);
+					ts_tree_delete(result.pTree);
+					for (Diagnostic& diagnostic : diagnostics)
+					{
+						const lsp::Position start = result.pSnapshot->GetPosition(diagnostic.startByte);
+						const lsp::Position end = result.pSnapshot->GetPosition(diagnostic.endByte);
+						report.entries.push_back(Entry{ start.line + 1, start.character + 1, end.line + 1, end.character + 1, diagnostic.severity, std::move(diagnostic.message) });
+					}
+				});
+		}
+		return reports;
+	}
+
+	static bool ReadFile(const std::string& path, std::string& outText)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::stringstream content;
+		content << file.rdbuf();
+		outText = content.str();
+		return true;
+	}
+
+	static const char* GetSeverityName(DiagnosticSeverity severity)
+	{
+		switch (severity)
+		{
+		case DiagnosticSeverity::Error: return "error";
+		case DiagnosticSeverity::Warning: return "warning";
+		case DiagnosticSeverity::Information: return "info";
+		default: return "hint";
+		}
+	}
+
+	static void WriteText(std::ostream& out, const std::vector<FileReport>& reports)
+	{
+		for (const FileReport& report : reports)
+			for (const Entry& entry : report.entries)
+				out << std::format("{}:{}:{}: {}: {}\n", report.path, entry.line, entry.column, GetSeverityName(entry.severity), entry.message);
+	}
+
+	static void WriteJson(std::ostream& out, const std::vector<FileReport>& reports, size_t errorCount)
+	{
+		out << std::format(R"({{"files":{},"errors":{},"diagnostics":[)", reports.size(), errorCount);
+		bool first = true;
+		for (const FileReport& report : reports)
+		{
+			for (const Entry& entry : report.entries)
+			{
+				out << std::format(R"({}{{"file":"{}","line":{},"column":{},"endLine":{},"endColumn":{},"severity":"{}","message":"{}"}})",
+					first ? "" : ",", EscapeJson(report.path), entry.line, entry.column, entry.endLine, entry.endColumn, GetSeverityName(entry.severity), EscapeJson(entry.message));
+				first = false;
+			}
+		}
+		out << "]}\n";
+	}
+};
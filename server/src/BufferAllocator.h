@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new> // align_val_t
+#include <mutex>
+#include <vector>
+#include <cassert>
+
+// Allocates the text buffers of the storages.
+// Implementations can round the requested count up, the caller gets the real size back and should use all of it.
+struct BufferAllocator
+{
+public:
+	using Type = uint8_t;
+
+	struct Stats
+	{
+		size_t usedBytes = 0;		// Bytes of the live blocks, after rounding up.
+		size_t peakUsedBytes = 0;
+		size_t cachedBytes = 0;		// Bytes of freed blocks kept for reuse.
+		size_t allocationCount = 0;
+		size_t reuseCount = 0;		// Allocations served from the cache.
+		size_t freeCount = 0;
+
+		// Share of the held bytes that sit unused in the cache.
+		double GetIdleFraction() const { return usedBytes + cachedBytes > 0 ? (double)cachedBytes / (usedBytes + cachedBytes) : 0.0; }
+	};
+
+	virtual ~BufferAllocator() {}
+
+	// Returns a block of at least minCount elements, outCount is set to the real size of the block.
+	virtual Type* Allocate(size_t minCount, size_t& outCount) = 0;
+	// count: The size returned by Allocate.
+	virtual void Free(Type* pData, size_t count) = 0;
+
+	virtual Stats GetStats() const = 0;
+
+	// The size a buffer of 'count' elements grows to when it needs at least 'minCount'.
+	// Geometric, but by at most m_sMaxGrowStep at a time so large documents do not double their memory for a single paste.
+	static size_t GetGrowCount(size_t count, size_t minCount)
+	{
+		size_t growCount = count < m_sMaxGrowStep ? count * 2 : count + m_sMaxGrowStep;
+		return growCount > minCount ? growCount : minCount;
+	}
+
+	// Shared by all documents.
+	static BufferAllocator& GetDefault();
+
+private:
+	inline static constexpr size_t m_sMaxGrowStep = 16u << 20;
+};
+
+// Rounds small blocks up to power of two size classes and keeps freed blocks in a free list per class,
+// so documents that are opened, edited and closed reuse the same blocks instead of going to the heap.
+// Large blocks are rounded to whole pages, page aligned and returned to the heap right away.
+//
+// Class:   0      1      2            8
+// Size:    1K     2K     4K    ...    256K    | > 256K: multiple of 4K
+struct SlabAllocator : public BufferAllocator
+{
+public:
+	SlabAllocator() {}
+	~SlabAllocator()
+	{
+		for (std::vector<Type*>& freeList : m_FreeLists)
+			for (Type* pBlock : freeList)
+				::operator delete(pBlock, std::align_val_t(m_sSmallAlignment));
+	}
+
+	SlabAllocator(const SlabAllocator&) = delete;
+	SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+	Type* Allocate(size_t minCount, size_t& outCount) override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stats.allocationCount++;
+
+		if (minCount > m_sMaxSmallCount)
+		{
+			outCount = (minCount + m_sPageSize - 1) & ~(m_sPageSize - 1);
+			AddUsed(outCount);
+			return (Type*)::operator new(outCount, std::align_val_t(m_sPageSize));
+		}
+
+		const size_t sizeClass = GetSizeClass(minCount);
+		outCount = m_sMinSmallCount << sizeClass;
+		AddUsed(outCount);
+
+		std::vector<Type*>& freeList = m_FreeLists[sizeClass];
+		if (!freeList.empty())
+		{
+			Type* pBlock = freeList.back();
+			freeList.pop_back();
+			m_Stats.cachedBytes -= outCount;
+			m_Stats.reuseCount++;
+			return pBlock;
+		}
+		return (Type*)::operator new(outCount, std::align_val_t(m_sSmallAlignment));
+	}
+
+	void Free(Type* pData, size_t count) override
+	{
+		if (pData == nullptr)
+			return;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stats.freeCount++;
+		m_Stats.usedBytes -= count;
+
+		if (count > m_sMaxSmallCount)
+		{
+			::operator delete(pData, std::align_val_t(m_sPageSize));
+			return;
+		}
+
+#ifdef MSLP_DEBUG
+		assert(count == (m_sMinSmallCount << GetSizeClass(count)) && "Count must be the size returned by Allocate!");
+#endif
+		// Keep the block for the next document unless the cache is full, so RSS is bounded after many documents were closed.
+		if (m_Stats.cachedBytes + count > m_sMaxCachedBytes)
+		{
+			::operator delete(pData, std::align_val_t(m_sSmallAlignment));
+			return;
+		}
+		m_FreeLists[GetSizeClass(count)].push_back(pData);
+		m_Stats.cachedBytes += count;
+	}
+
+	Stats GetStats() const override
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Stats;
+	}
+
+private:
+	void AddUsed(size_t count)
+	{
+		m_Stats.usedBytes += count;
+		if (m_Stats.usedBytes > m_Stats.peakUsedBytes)
+			m_Stats.peakUsedBytes = m_Stats.usedBytes;
+	}
+
+	static size_t GetSizeClass(size_t count)
+	{
+		size_t sizeClass = 0;
+		while ((m_sMinSmallCount << sizeClass) < count)
+			sizeClass++;
+		return sizeClass;
+	}
+
+private:
+	inline static constexpr size_t m_sMinSmallCount = 1024;
+	inline static constexpr size_t m_sClassCount = 9;
+	inline static constexpr size_t m_sMaxSmallCount = m_sMinSmallCount << (m_sClassCount - 1);
+	inline static constexpr size_t m_sPageSize = 4096;
+	inline static constexpr size_t m_sSmallAlignment = 64;
+	inline static constexpr size_t m_sMaxCachedBytes = 16u << 20;
+
+	mutable std::mutex m_Mutex;
+	std::vector<Type*> m_FreeLists[m_sClassCount];
+	Stats m_Stats;
+};
+
+inline BufferAllocator& BufferAllocator::GetDefault()
+{
+	static SlabAllocator s_Allocator;
+	return s_Allocator;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <lsp/messages.h>
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <variant>
+#include <type_traits>
+#include <unordered_map>
+
+// Tells long running work that its result is no longer wanted. Copies share the same state,
+// the thread that wants the work to stop calls Cancel and the thread doing the work checks IsCancelled now and then.
+struct CancellationToken
+{
+public:
+	CancellationToken() : m_pFlag(std::make_shared<std::atomic<size_t>>(0)) {}
+
+	void Cancel() const { m_pFlag->store(1, std::memory_order_relaxed); }
+	bool IsCancelled() const { return m_pFlag->load(std::memory_order_relaxed) != 0; }
+
+	// Ends the request with a RequestCancelled error if it was cancelled.
+	void ThrowIfCancelled() const
+	{
+		if (IsCancelled())
+			throw lsp::RequestError(static_cast<int>(lsp::LSPErrorCodes::RequestCancelled), "Request cancelled");
+	}
+
+	// For ts_parser_set_cancellation_flag, which stops the parse once the flag is non-zero.
+	const size_t* GetFlag() const
+	{
+		static_assert(sizeof(std::atomic<size_t>) == sizeof(size_t) && std::atomic<size_t>::is_always_lock_free, "The flag is read by tree-sitter as a plain size_t");
+		return reinterpret_cast<const size_t*>(m_pFlag.get());
+	}
+
+private:
+	std::shared_ptr<std::atomic<size_t>> m_pFlag;
+};
+
+// Tokens of the requests that are being handled, so that $/cancelRequest can reach them.
+// Request handlers call Begin when they start and End when they have replied, from any thread.
+struct PendingRequests
+{
+public:
+	template<typename Id>
+	CancellationToken Begin(const Id& id)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Tokens[GetKey(id)];
+	}
+
+	template<typename Id>
+	void End(const Id& id)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tokens.erase(GetKey(id));
+	}
+
+	// Requests that have already been replied to are ignored, returns false for them.
+	template<typename Id>
+	bool Cancel(const Id& id)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto it = m_Tokens.find(GetKey(id));
+		if (it == m_Tokens.end())
+			return false;
+		it->second.Cancel();
+		return true;
+	}
+
+	void CancelAll()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (auto& [key, token] : m_Tokens)
+			token.Cancel();
+	}
+
+	// Registers a request for as long as the scope lives, which for a coroutine is until it has finished.
+	struct Scope
+	{
+	public:
+		template<typename Id>
+		Scope(PendingRequests& requests, const Id& id) : m_Requests(requests), m_Key(GetKey(id))
+		{
+			std::lock_guard<std::mutex> lock(m_Requests.m_Mutex);
+			m_Token = m_Requests.m_Tokens[m_Key];
+		}
+
+		~Scope()
+		{
+			std::lock_guard<std::mutex> lock(m_Requests.m_Mutex);
+			m_Requests.m_Tokens.erase(m_Key);
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+		const CancellationToken& GetToken() const { return m_Token; }
+
+	private:
+		PendingRequests& m_Requests;
+		std::string m_Key;
+		CancellationToken m_Token;
+	};
+
+private:
+	// Request ids are either numbers or strings, "1" and 1 are different requests.
+	template<typename Id>
+	static std::string GetKey(const Id& id)
+	{
+		return std::visit([](const auto& value) -> std::string
+			{
+				if constexpr (std::is_arithmetic_v<std::decay_t<decltype(value)>>)
+					return "#" + std::to_string(value);
+				else
+					return "\"" + std::string(value);
+			}, id);
+	}
+
+private:
+	std::mutex m_Mutex;
+	std::unordered_map<std::string, CancellationToken> m_Tokens;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <lsp/messages.h>
+#include <tree_sitter/api.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <format>
+#include <cstdint>
+
+#include "TextStorage.h"
+#include "LineIndex.h"
+#include "TreeChanges.h"
+#include "TreeWalk.h"
+#include "Trace.h"
+
+// Same values as the LSP DiagnosticSeverity.
+enum class DiagnosticSeverity
+{
+	Error = 1,
+	Warning = 2,
+	Information = 3,
+	Hint = 4,
+};
+
+// A problem found in a document. The range is in bytes, converted to positions by whoever reports it.
+struct Diagnostic
+{
+	uint32_t startByte = 0;
+	uint32_t endByte = 0;
+	DiagnosticSeverity severity = DiagnosticSeverity::Error;
+	std::string message;
+
+	bool operator==(const Diagnostic&) const = default;
+};
+
+namespace Diagnostics
+{
+	// True if the range overlaps [startByte, endByte). An empty range at startByte overlaps too.
+	inline bool Overlaps(uint32_t rangeStart, uint32_t rangeEnd, uint32_t startByte, uint32_t endByte)
+	{
+		return rangeStart < endByte && rangeEnd >= startByte;
+	}
+
+	// Adds the ERROR and MISSING nodes it visits, see CollectSyntaxErrors.
+	struct SyntaxErrorVisitor
+	{
+		using Kinds = TreeWalk::KindList<>;
+
+		std::vector<Diagnostic>& outDiagnostics;
+		size_t endCount;
+
+		TreeWalk::Action Default(const TreeWalk::Node& node)
+		{
+			if (ts_node_is_missing(node.node))
+				outDiagnostics.push_back(Diagnostic{ node.startByte, node.endByte, DiagnosticSeverity::Error, std::format("Missing {}", ts_node_type(node.node)) });
+			else if (ts_node_is_error(node.node))
+				outDiagnostics.push_back(Diagnostic{ node.startByte, node.endByte, DiagnosticSeverity::Error, "Syntax error" });
+			else
+				return ts_node_has_error(node.node) ? TreeWalk::Action::Children : TreeWalk::Action::SkipChildren;
+			return outDiagnostics.size() < endCount ? TreeWalk::Action::SkipChildren : TreeWalk::Action::Stop;
+		}
+	};
+
+	// Adds the syntax errors of the tree under 'node': the text the parser could not make sense of (ERROR nodes)
+	// and the tokens it had to make up (MISSING nodes). Only subtrees that contain an error are visited.
+	// maxCount: Stops after this many, one broken construct can cause many follow-up errors.
+	// startByte, endByte: Only the errors that overlap the range, only visiting the subtrees that do.
+	inline void CollectSyntaxErrors(TSNode node, std::vector<Diagnostic>& outDiagnostics, size_t maxCount = 100, uint32_t startByte = 0, uint32_t endByte = UINT32_MAX)
+	{
+		if (!ts_node_has_error(node) || maxCount == 0)
+			return;
+		SyntaxErrorVisitor visitor{ outDiagnostics, maxCount == SIZE_MAX ? SIZE_MAX : outDiagnostics.size() + maxCount };
+		TreeWalk::Walk(node, visitor, startByte, endByte);
+	}
+}
+
+// Syntax errors of a document, kept up to date with every tree by only revisiting the subtrees that overlap the lines that changed (see TreeChanges).
+// Also remembers what was last sent to the client, so unchanged diagnostics are not sent again:
+// pushed diagnostics are only published when they changed, and pulled ones are answered with 'unchanged' for the same result id.
+struct DiagnosticCache
+{
+public:
+	bool IsBuilt() const { return m_Built; }
+	const std::vector<Diagnostic>& Get() const { return m_Diagnostics; }
+
+	// Drops the diagnostics, the next tree builds them again. What was last sent is kept to tell if they changed.
+	void Clear()
+	{
+		m_Built = false;
+		m_Diagnostics.clear();
+	}
+
+	// Walks all subtrees with errors.
+	void Build(TSNode root)
+	{
+		MSLP_TRACE_ZONE("Diagnostics");
+		m_Diagnostics.clear();
+		Diagnostics::CollectSyntaxErrors(root, m_Diagnostics, SIZE_MAX);
+		Sort();
+		m_Built = true;
+	}
+
+	// Brings the diagnostics up to date with a new tree. The ones outside the lines that changed are moved along with the edits and kept.
+	// edits: Applied to the old tree since the diagnostics were last updated, in order.
+	// pChangedRanges: From ts_tree_get_changed_ranges between the old and the new tree.
+	void Update(TSNode root, const LineIndex& lines, const std::vector<TSInputEdit>& edits, const TSRange* pChangedRanges, uint32_t changedRangeCount)
+	{
+		if (!m_Built)
+			return;
+		MSLP_TRACE_ZONE("Diagnostics");
+
+		for (const TSInputEdit& edit : edits)
+		{
+			for (Diagnostic& diagnostic : m_Diagnostics)
+			{
+				diagnostic.startByte = TreeChanges::MoveOffset(diagnostic.startByte, edit);
+				diagnostic.endByte = TreeChanges::MoveOffset(diagnostic.endByte, edit, true);
+			}
+		}
+
+		const std::vector<TreeChanges::Span> spans = TreeChanges::GetChangedLines(lines, edits, pChangedRanges, changedRangeCount);
+		if (spans.empty())
+			return;
+
+		std::erase_if(m_Diagnostics, [&spans](const Diagnostic& diagnostic)
+			{
+				return std::any_of(spans.begin(), spans.end(), [&diagnostic](const TreeChanges::Span& span)
+					{
+						return Diagnostics::Overlaps(diagnostic.startByte, diagnostic.endByte, span.start, span.end);
+					});
+			});
+		for (const TreeChanges::Span& span : spans)
+			Diagnostics::CollectSyntaxErrors(root, m_Diagnostics, SIZE_MAX, span.start, span.end);
+
+		Sort();
+	}
+
+	// Converts the diagnostics to what is sent to the client, the first m_sMaxResolvedCount of them.
+	// Returns true, and changes the result id, if they differ from the ones of the previous call.
+	bool Resolve(const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding)
+	{
+		std::vector<lsp::Diagnostic> resolved;
+		const size_t count = std::min(m_Diagnostics.size(), m_sMaxResolvedCount);
+		resolved.reserve(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			lsp::Diagnostic diagnostic;
+			diagnostic.range.start = GetPosition(storage, lines, encoding, m_Diagnostics[i].startByte);
+			diagnostic.range.end = GetPosition(storage, lines, encoding, m_Diagnostics[i].endByte);
+			diagnostic.severity = static_cast<lsp::DiagnosticSeverity>(m_Diagnostics[i].severity);
+			diagnostic.source = "hlslv";
+			diagnostic.message = m_Diagnostics[i].message;
+			resolved.push_back(std::move(diagnostic));
+		}
+
+		if (m_ResultId > 0 && IsSame(resolved, m_Resolved))
+			return false;
+		m_Resolved = std::move(resolved);
+		m_ResultId++;
+		return true;
+	}
+
+	const std::vector<lsp::Diagnostic>& GetResolved() const { return m_Resolved; }
+	std::string GetResultId() const { return std::to_string(m_ResultId); }
+
+private:
+	// Also drops duplicates, an error across more than one span of an update is found once for each.
+	void Sort()
+	{
+		std::sort(m_Diagnostics.begin(), m_Diagnostics.end(), [](const Diagnostic& a, const Diagnostic& b)
+			{
+				return a.startByte != b.startByte ? a.startByte < b.startByte : a.endByte != b.endByte ? a.endByte < b.endByte : a.message < b.message;
+			});
+		m_Diagnostics.erase(std::unique(m_Diagnostics.begin(), m_Diagnostics.end()), m_Diagnostics.end());
+	}
+
+	static lsp::Position GetPosition(const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding, size_t offset)
+	{
+		lsp::Position position;
+		uint32_t line, character;
+		lines.OffsetToPosition(storage, std::min(offset, storage.GetCount()), encoding, line, character);
+		position.line = line;
+		position.character = character;
+		return position;
+	}
+
+	static bool IsSame(const std::vector<lsp::Diagnostic>& a, const std::vector<lsp::Diagnostic>& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const lsp::Diagnostic& x, const lsp::Diagnostic& y)
+			{
+				return x.range.start.line == y.range.start.line && x.range.start.character == y.range.start.character
+					&& x.range.end.line == y.range.end.line && x.range.end.character == y.range.end.character
+					&& x.severity == y.severity && x.message == y.message;
+			});
+	}
+
+private:
+	inline static constexpr size_t m_sMaxResolvedCount = 100; // One broken construct can cause many follow-up errors.
+
+	bool m_Built = false;
+	std::vector<Diagnostic> m_Diagnostics;	// Sorted by start.
+	uint64_t m_ResultId = 0;
+	std::vector<lsp::Diagnostic> m_Resolved;
+};
@@ -0,0 +1,393 @@
+#pragma once
+
+#include <lsp/messages.h>
+#include <tree_sitter/api.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <utility>
+
+#include "GapBufferStorage.h"
+#include "PieceTree.h"
+#include "LineIndex.h"
+#include "DocumentSnapshot.h"
+#include "SemanticTokens.h"
+#include "AstSnapshot.h"
+#include "Diagnostics.h"
+#include "Trace.h"
+
+// Results derived from the current tree of a document.
+struct DocumentAnalysis
+{
+	int parsedVersion = -1; // Version of the document that the tree was parsed from. -1 if not parsed yet.
+	bool hasSyntaxErrors = false;
+};
+
+// Per-URI state of an open text document.
+struct Document
+{
+public:
+	// storageKind: The backend to store the text in, Auto picks one from the size and later from the edit pattern.
+	// encoding: How the character of the LSP positions given to and returned from the document are counted.
+	Document(const std::string& uri, int version, const std::string& text, TextStorageKind storageKind = TextStorageKind::Auto, PositionEncoding encoding = PositionEncoding::UTF16)
+		: m_Uri(uri), m_StorageKind(storageKind), m_Encoding(encoding)
+	{
+		Reset(version, text);
+	}
+
+	~Document()
+	{
+		DeleteTree();
+	}
+
+	Document(const Document&) = delete;
+	Document& operator=(const Document&) = delete;
+
+	// Replaces the whole document, the next parse will start from scratch.
+	void Reset(int version, const std::string& text)
+	{
+		m_pStorage = CreateStorage((const TextStorage::Type*)text.data(), text.size());
+		m_pLines = std::make_shared<LineIndex>();
+		m_pLines->Build(*m_pStorage);
+		m_pLastSnapshot.reset();
+		m_Version = version;
+		DeleteTree();
+		m_TreeEdits.clear();
+		m_UnparsedEdits.clear();
+		m_UnparsedVersions.clear();
+		m_UnparsedVersions.push_back(UnparsedVersion{ version, 0 });
+		m_SemanticTokens.Clear();
+		m_Diagnostics.Clear();
+		m_Ast.Clear();
+	}
+
+	// range: The range of the document that got changed
+	// text: The text to replace the text in the range.
+	// Note: This only updates the buffer and the retained tree, the document needs to be reparsed when all changes have been applied.
+	void Edit(const lsp::Range& range, const std::string& text)
+	{
+		MakeWritable();
+
+		TSInputEdit edit;
+		edit.start_byte = (uint32_t)m_pLines->PositionToOffset(*m_pStorage, range.start.line, range.start.character, m_Encoding);
+		edit.old_end_byte = (uint32_t)m_pLines->PositionToOffset(*m_pStorage, range.end.line, range.end.character, m_Encoding);
+		if (edit.old_end_byte < edit.start_byte)
+			std::swap(edit.start_byte, edit.old_end_byte); // A client sent the range backwards, the erase count would wrap around.
+		edit.new_end_byte = edit.start_byte + (uint32_t)text.size();
+		edit.start_point = GetPoint(edit.start_byte);
+		edit.old_end_point = GetPoint(edit.old_end_byte);
+
+		m_pStorage->Erase(edit.start_byte, edit.old_end_byte - edit.start_byte);
+		m_pStorage->Insert(edit.start_byte, (const TextStorage::Type*)text.data(), text.size());
+		m_pLines->Edit(*m_pStorage, edit.start_byte, edit.old_end_byte, edit.new_end_byte);
+
+		edit.new_end_point = GetPoint(edit.new_end_byte);
+
+		RecordEdit(edit);
+	}
+
+	// Applies the changes of a change notification and moves the document to the new version.
+	// Note: This only updates the buffer and the retained tree, the document needs to be reparsed afterwards.
+	void ApplyChanges(int version, const std::vector<lsp::TextDocumentContentChangeEvent>& changes)
+	{
+		MSLP_TRACE_ZONE("Apply changes");
+		if (!ApplyChangeBatch(changes))
+		{
+			// Changes are given in order, each one relative to the document after the previous change.
+			for (const lsp::TextDocumentContentChangeEvent& change : changes)
+			{
+				if (const lsp::TextDocumentContentChangeEvent_Range_Text* pRangeEvent = std::get_if<lsp::TextDocumentContentChangeEvent_Range_Text>(&change))
+					Edit(pRangeEvent->range, pRangeEvent->text);
+				else // Full document content, the retained tree cannot be reused.
+					Reset(version, std::get<lsp::TextDocumentContentChangeEvent_Text>(change).text);
+			}
+
+			// Edits spread over the whole document move the gap of a GapBuffer back and forth, so many changes that could not be batched
+			// switch an Auto document over to a PieceTree.
+			if (m_StorageKind == TextStorageKind::Auto && m_pStorage->GetKind() == TextStorageKind::GapBuffer && changes.size() >= m_sScatteredChangeCount)
+			{
+				std::string text = GetText();
+				m_pStorage = std::make_shared<PieceTree>((const TextStorage::Type*)text.data(), text.size());
+			}
+		}
+
+		m_Version = version;
+		m_pLastSnapshot.reset();
+		if (m_pTree == nullptr && !m_UnparsedVersions.empty())
+			m_UnparsedVersions.push_back(UnparsedVersion{ version, m_UnparsedEdits.size() });
+	}
+
+	// Takes ownership of a tree parsed from the current buffer, replacing the old one.
+	void SetTree(TSTree* pTree)
+	{
+		// Results of the previous tree only walk the lines that changed since.
+		const TSNode root = ts_tree_root_node(pTree);
+		if (m_pTree)
+		{
+			uint32_t changedRangeCount = 0;
+			TSRange* pChangedRanges = ts_tree_get_changed_ranges(m_pTree, pTree, &changedRangeCount);
+			m_SemanticTokens.Update(root, *m_pStorage, *m_pLines, m_Encoding, m_TreeEdits, pChangedRanges, changedRangeCount);
+			m_Diagnostics.Update(root, *m_pLines, m_TreeEdits, pChangedRanges, changedRangeCount);
+			m_Ast.Update(root, *m_pStorage, *m_pLines, m_TreeEdits, pChangedRanges, changedRangeCount);
+			free(pChangedRanges);
+		}
+		else
+		{
+			m_SemanticTokens.Clear();
+			m_Ast.Clear();
+		}
+		if (!m_Diagnostics.IsBuilt())
+			m_Diagnostics.Build(root);
+		m_TreeEdits.clear();
+		m_UnparsedEdits.clear();
+		m_UnparsedVersions.clear();
+
+		DeleteTree();
+		m_pLastSnapshot.reset();
+		m_pTree = pTree;
+		m_Analysis.parsedVersion = m_Version;
+		m_Analysis.hasSyntaxErrors = ts_node_has_error(ts_tree_root_node(m_pTree));
+	}
+
+	// Takes a tree parsed from a snapshot on another thread.
+	// Returns false, leaving the tree to the caller, if the document has changed since the snapshot was taken.
+	bool SetParsedTree(const DocumentSnapshot& snapshot, TSTree* pTree)
+	{
+		// The snapshot shares the storage until the next edit copies it, so the same storage means the same text.
+		if (snapshot.GetVersion() != m_Version || &snapshot.GetStorage() != m_pStorage.get())
+			return false;
+		SetTree(pTree);
+		return true;
+	}
+
+	// Takes a tree parsed from an older snapshot while the document has no tree at all, which is the case while the first parse of a large document
+	// is overtaken by typing. The edits made since the snapshot are applied to it, so the next parse reuses it instead of starting from scratch again.
+	// The tree is not current, nothing is derived from it until that parse.
+	// Returns false, leaving the tree to the caller, if the document has a tree or the edits since the snapshot are not known.
+	bool AdoptStaleTree(const DocumentSnapshot& snapshot, TSTree* pTree)
+	{
+		if (m_pTree || snapshot.GetVersion() == m_Version)
+			return false;
+		auto it = std::find_if(m_UnparsedVersions.rbegin(), m_UnparsedVersions.rend(), [&snapshot](const UnparsedVersion& version) { return version.version == snapshot.GetVersion(); });
+		if (it == m_UnparsedVersions.rend())
+			return false;
+
+		MSLP_TRACE_ZONE("Tree edit");
+		m_TreeEdits.assign(m_UnparsedEdits.begin() + it->editCount, m_UnparsedEdits.end());
+		for (const TSInputEdit& edit : m_TreeEdits)
+			ts_tree_edit(pTree, &edit);
+		m_UnparsedEdits.clear();
+		m_UnparsedVersions.clear();
+
+		m_pTree = pTree;
+		m_Analysis.parsedVersion = snapshot.GetVersion();
+		return true;
+	}
+
+	// Returns a copy of the retained tree, with all edits since the last parse applied, to reparse from on another thread. nullptr if there is none.
+	TSTree* CopyTree() const { return m_pTree ? ts_tree_copy(m_pTree) : nullptr; }
+
+	// Copies the text of the document into a contiguous string.
+	std::string GetText() const
+	{
+		std::string text;
+		text.resize(m_pStorage->GetCount());
+		m_pStorage->CopyTo((TextStorage::Type*)text.data());
+		return text;
+	}
+
+	const std::string& GetUri() const { return m_Uri; }
+	int GetVersion() const { return m_Version; }
+	const TextStorage& GetStorage() const { return *m_pStorage; }
+	const LineIndex& GetLines() const { return *m_pLines; }
+
+	// Returns an immutable snapshot of the current version, which can be read from other threads while the document keeps changing.
+	// The snapshot shares the text with the document until the next edit, which then copies it (copy-on-write).
+	// Until the document changes, the same snapshot is returned as long as one reference to it is alive.
+	DocumentSnapshotPtr GetSnapshot()
+	{
+		DocumentSnapshotPtr pSnapshot = m_pLastSnapshot.lock();
+		if (pSnapshot)
+			return pSnapshot;
+
+		const bool hasTree = m_pTree && m_Analysis.parsedVersion == m_Version;
+		pSnapshot = std::make_shared<const DocumentSnapshot>(m_Uri, m_Version, m_Encoding, m_pStorage, m_pLines, hasTree ? m_pTree : nullptr);
+		m_pLastSnapshot = pSnapshot;
+		return pSnapshot;
+	}
+	PositionEncoding GetEncoding() const { return m_Encoding; }
+
+	// Row and byte column of a byte offset.
+	TSPoint GetPoint(size_t offset) const { return DocumentSnapshot::GetPoint(*m_pLines, offset); }
+	lsp::Position GetPosition(size_t offset) const { return DocumentSnapshot::GetPosition(*m_pStorage, *m_pLines, m_Encoding, offset); }
+	size_t GetOffset(const lsp::Position& position) const { return m_pLines->PositionToOffset(*m_pStorage, position.line, position.character, m_Encoding); }
+	TSTree* GetTree() const { return m_pTree; }
+	const DocumentAnalysis& GetAnalysis() const { return m_Analysis; }
+
+	// Syntax errors of the current tree, kept up to date with every tree.
+	DiagnosticCache& GetDiagnostics() { return m_Diagnostics; }
+
+	// Semantic tokens of the current tree, built on first use and kept up to date with every tree after that.
+	SemanticTokens& GetSemanticTokens()
+	{
+		if (!m_SemanticTokens.IsBuilt() && m_pTree && m_Analysis.parsedVersion == m_Version)
+			m_SemanticTokens.Build(ts_tree_root_node(m_pTree), *m_pStorage, *m_pLines, m_Encoding);
+		return m_SemanticTokens;
+	}
+
+	// The flattened tree for analysis passes, built on first use and then kept up to date with every tree.
+	const AstSnapshot& GetAst()
+	{
+		if (!m_Ast.IsBuilt() && m_pTree && m_Analysis.parsedVersion == m_Version)
+			m_Ast.Build(ts_tree_root_node(m_pTree), *m_pStorage);
+		return m_Ast;
+	}
+
+private:
+	// Applies all changes as a single batch on the storage, if they can be expressed in offsets of the text before the batch.
+	// That is the case when every change comes before the previous one, which is how formatters and multi-cursor edits are sent.
+	// Returns false if the changes need to be applied one at a time.
+	bool ApplyChangeBatch(const std::vector<lsp::TextDocumentContentChangeEvent>& changes)
+	{
+		if (changes.size() < 2)
+			return false;
+		MakeWritable();
+
+		// Rows and columns covered by the erased text of an edit.
+		struct Extent
+		{
+			uint32_t rows;
+			uint32_t columns; // Columns on the last row.
+		};
+
+		// Collected from the last change to the first, which is from the start of the document towards the end.
+		std::vector<TextEdit> edits(changes.size());
+		std::vector<Extent> erasedExtents(changes.size());
+		for (size_t i = 0; i < changes.size(); ++i)
+		{
+			const lsp::TextDocumentContentChangeEvent_Range_Text* pRangeEvent = std::get_if<lsp::TextDocumentContentChangeEvent_Range_Text>(&changes[i]);
+			if (pRangeEvent == nullptr)
+				return false;
+
+			size_t start = GetOffset(pRangeEvent->range.start);
+			size_t end = GetOffset(pRangeEvent->range.end);
+			if (end < start)
+				std::swap(start, end);
+			const size_t index = changes.size() - 1 - i;
+			if (i > 0 && end > edits[index + 1].start)
+				return false;
+
+			edits[index] = TextEdit{ start, end - start, (const TextStorage::Type*)pRangeEvent->text.data(), pRangeEvent->text.size() };
+
+			const TSPoint startPoint = GetPoint(start);
+			const TSPoint endPoint = GetPoint(end);
+			erasedExtents[index].rows = endPoint.row - startPoint.row;
+			erasedExtents[index].columns = erasedExtents[index].rows > 0 ? endPoint.column : endPoint.column - startPoint.column;
+		}
+
+		m_pStorage->ApplyEdits(edits.data(), edits.size());
+		m_pLines->EditBatch(*m_pStorage, edits.data(), edits.size());
+
+		// The edits were applied from the start of the document towards the end, so the text before each edit, and its inserted text,
+		// are already in their final state. Only the erased text needs the extent that was measured before the batch.
+		for (size_t i = 0; i < edits.size(); ++i)
+		{
+			const TextEdit& applied = edits[i];
+			TSInputEdit edit;
+			edit.start_byte = (uint32_t)applied.start;
+			edit.old_end_byte = (uint32_t)(applied.start + applied.eraseCount);
+			edit.new_end_byte = (uint32_t)(applied.start + applied.dataCount);
+			edit.start_point = GetPoint(edit.start_byte);
+			edit.old_end_point.row = edit.start_point.row + erasedExtents[i].rows;
+			edit.old_end_point.column = erasedExtents[i].rows > 0 ? erasedExtents[i].columns : edit.start_point.column + erasedExtents[i].columns;
+			edit.new_end_point = GetPoint(edit.new_end_byte);
+			RecordEdit(edit);
+		}
+		return true;
+	}
+
+	// Applies an edit to the retained tree. Without one, the edit is kept for AdoptStaleTree, as long as there are not too many.
+	void RecordEdit(const TSInputEdit& edit)
+	{
+		if (m_pTree)
+		{
+			MSLP_TRACE_ZONE("Tree edit");
+			ts_tree_edit(m_pTree, &edit);
+			m_TreeEdits.push_back(edit);
+		}
+		else if (!m_UnparsedVersions.empty())
+		{
+			if (m_UnparsedEdits.size() < m_sMaxUnparsedEditCount)
+				m_UnparsedEdits.push_back(edit);
+			else
+			{
+				m_UnparsedEdits.clear();
+				m_UnparsedVersions.clear(); // Too far behind, the next parse starts from scratch.
+			}
+		}
+	}
+
+	// Copies the text and lines before they are written to if a snapshot still refers to them.
+	// Note: Snapshots are only created on the thread that owns the document, so the use count cannot grow concurrently.
+	void MakeWritable()
+	{
+		m_pLastSnapshot.reset();
+		if (m_pStorage.use_count() > 1)
+			m_pStorage = m_pStorage->Clone();
+		if (m_pLines.use_count() > 1)
+			m_pLines = std::make_shared<LineIndex>(*m_pLines);
+	}
+
+	std::unique_ptr<TextStorage> CreateStorage(const TextStorage::Type* pData, size_t count) const
+	{
+		TextStorageKind kind = m_StorageKind;
+		if (kind == TextStorageKind::Auto)
+			kind = count >= m_sLargeDocumentCount ? TextStorageKind::PieceTree : TextStorageKind::GapBuffer;
+
+		if (kind == TextStorageKind::PieceTree)
+			return std::make_unique<PieceTree>(pData, count);
+		return std::make_unique<GapBufferStorage>(pData, count, std::max(count / 4, m_sMinGapCount));
+	}
+
+	void DeleteTree()
+	{
+		if (m_pTree)
+		{
+			ts_tree_delete(m_pTree);
+			m_pTree = nullptr;
+		}
+		m_Analysis = DocumentAnalysis();
+	}
+
+private:
+	inline static constexpr size_t m_sMinGapCount = 1024;
+	inline static constexpr size_t m_sLargeDocumentCount = 4u << 20;	// Auto: Documents of this size or larger start out as a PieceTree.
+	inline static constexpr size_t m_sScatteredChangeCount = 16;		// Auto: This many changes in one notification that cannot be batched switches to a PieceTree.
+	inline static constexpr size_t m_sMaxUnparsedEditCount = 4096;	// Edits kept for AdoptStaleTree.
+
+	std::string m_Uri;
+	int m_Version = 0;
+	TextStorageKind m_StorageKind = TextStorageKind::Auto;
+	PositionEncoding m_Encoding = PositionEncoding::UTF16;
+	std::shared_ptr<TextStorage> m_pStorage;
+	std::shared_ptr<LineIndex> m_pLines;
+	std::weak_ptr<const DocumentSnapshot> m_pLastSnapshot;
+	TSTree* m_pTree = nullptr;
+	std::vector<TSInputEdit> m_TreeEdits;	// Applied to the tree since it was parsed.
+
+	// Where a version starts in m_UnparsedEdits.
+	struct UnparsedVersion
+	{
+		int version;
+		size_t editCount;
+	};
+	// While there is no tree: The edits since the text was set, and the versions they lead to. Empty if they are not complete.
+	std::vector<TSInputEdit> m_UnparsedEdits;
+	std::vector<UnparsedVersion> m_UnparsedVersions;
+	DocumentAnalysis m_Analysis;
+	SemanticTokens m_SemanticTokens;
+	DiagnosticCache m_Diagnostics;
+	AstSnapshot m_Ast;
+};
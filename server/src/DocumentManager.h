@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+
+#include "Document.h"
+
+// Owns the state of every open document, keyed by URI.
+struct DocumentManager
+{
+public:
+	// Opens a document, replacing any previous state with the same URI.
+	Document& Open(const std::string& uri, int version, const std::string& text)
+	{
+		std::unique_ptr<Document>& pDocument = m_Documents[uri];
+		pDocument = std::make_unique<Document>(uri, version, text, m_StorageKind, m_Encoding);
+		return *pDocument;
+	}
+
+	// Frees the buffer, tree and analysis results of the document.
+	void Close(const std::string& uri)
+	{
+		m_Documents.erase(uri);
+	}
+
+	// Returns nullptr if the document is not open.
+	Document* Get(const std::string& uri)
+	{
+		auto it = m_Documents.find(uri);
+		return it != m_Documents.end() ? it->second.get() : nullptr;
+	}
+
+	// Returns the document if a change with the given version can be applied to it.
+	// Changes to unknown documents, and versions that are not newer than the current one (stale or out-of-order), return nullptr.
+	Document* GetForChange(const std::string& uri, int version)
+	{
+		Document* pDocument = Get(uri);
+		if (pDocument == nullptr || version <= pDocument->GetVersion())
+			return nullptr;
+		return pDocument;
+	}
+
+	size_t GetCount() const { return m_Documents.size(); }
+
+	// Backend used for documents opened from now on.
+	void SetStorageKind(TextStorageKind kind) { m_StorageKind = kind; }
+
+	// Position encoding agreed on with the client during initialization.
+	void SetPositionEncoding(PositionEncoding encoding) { m_Encoding = encoding; }
+	PositionEncoding GetPositionEncoding() const { return m_Encoding; }
+
+private:
+	TextStorageKind m_StorageKind = TextStorageKind::Auto;
+	PositionEncoding m_Encoding = PositionEncoding::UTF16;
+	std::unordered_map<std::string, std::unique_ptr<Document>> m_Documents;
+};
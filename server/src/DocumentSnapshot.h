@@ -0,0 +1,86 @@
+#pragma once
+
+#include <lsp/messages.h>
+#include <tree_sitter/api.h>
+
+#include <string>
+#include <memory>
+
+#include "TextStorage.h"
+#include "LineIndex.h"
+
+// Immutable view of one version of a document. Safe to read from any thread while the document keeps changing,
+// hold it through a DocumentSnapshotPtr for as long as it is needed.
+struct DocumentSnapshot
+{
+public:
+	// pTree: Tree parsed from this version, or nullptr. The snapshot keeps its own copy of it.
+	DocumentSnapshot(const std::string& uri, int version, PositionEncoding encoding, std::shared_ptr<const TextStorage> pStorage, std::shared_ptr<const LineIndex> pLines, const TSTree* pTree)
+		: m_Uri(uri), m_Version(version), m_Encoding(encoding), m_pStorage(std::move(pStorage)), m_pLines(std::move(pLines))
+	{
+		// Trees cannot be shared between threads, copying is cheap since the nodes are reference counted.
+		if (pTree)
+			m_pTree = ts_tree_copy(pTree);
+	}
+
+	~DocumentSnapshot()
+	{
+		if (m_pTree)
+			ts_tree_delete(m_pTree);
+	}
+
+	DocumentSnapshot(const DocumentSnapshot&) = delete;
+	DocumentSnapshot& operator=(const DocumentSnapshot&) = delete;
+
+	const std::string& GetUri() const { return m_Uri; }
+	int GetVersion() const { return m_Version; }
+	PositionEncoding GetEncoding() const { return m_Encoding; }
+	const TextStorage& GetStorage() const { return *m_pStorage; }
+	const LineIndex& GetLines() const { return *m_pLines; }
+
+	bool HasTree() const { return m_pTree != nullptr; }
+	// Note: The tree belongs to the snapshot, copy it with ts_tree_copy to use it on more than one thread at a time.
+	const TSTree* GetTree() const { return m_pTree; }
+	TSNode GetRootNode() const { return ts_tree_root_node(m_pTree); }
+
+	std::string GetText() const
+	{
+		std::string text;
+		text.resize(m_pStorage->GetCount());
+		m_pStorage->CopyTo((TextStorage::Type*)text.data());
+		return text;
+	}
+
+	TSPoint GetPoint(size_t offset) const { return GetPoint(*m_pLines, offset); }
+	lsp::Position GetPosition(size_t offset) const { return GetPosition(*m_pStorage, *m_pLines, m_Encoding, offset); }
+	size_t GetOffset(const lsp::Position& position) const { return m_pLines->PositionToOffset(*m_pStorage, position.line, position.character, m_Encoding); }
+
+	// Row and byte column of a byte offset.
+	static TSPoint GetPoint(const LineIndex& lines, size_t offset)
+	{
+		TSPoint point;
+		point.row = lines.LineAt(offset);
+		point.column = (uint32_t)(offset - lines.LineStart(point.row));
+		return point;
+	}
+
+	static lsp::Position GetPosition(const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding, size_t offset)
+	{
+		lsp::Position position;
+		uint32_t line, character;
+		lines.OffsetToPosition(storage, offset, encoding, line, character);
+		position.line = line;
+		position.character = character;
+		return position;
+	}
+
+private:
+	std::string m_Uri;
+	int m_Version = 0;
+	PositionEncoding m_Encoding = PositionEncoding::UTF16;
+	std::shared_ptr<const TextStorage> m_pStorage;
+	std::shared_ptr<const LineIndex> m_pLines;
+	TSTree* m_pTree = nullptr;
+};
+
+using DocumentSnapshotPtr = std::shared_ptr<const DocumentSnapshot>;
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Runs work on the message thread: tasks posted from other threads and timers.
+// The message thread runs it while it waits for input, see RunUntil.
+struct EventLoop
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using Task = std::function<void()>;
+
+	// Runs the task on the message thread. Can be called from any thread.
+	void Post(Task task)
+	{
+		// Notified under the lock, the loop can be destroyed as soon as the task has run.
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Posted.push_back(std::move(task));
+		m_Condition.notify_one();
+	}
+
+	// Runs the task once the delay has passed. A timer with the same key that has not run yet is replaced,
+	// which is what debouncing needs: only the last of a burst of calls runs.
+	// Note: Timers are only set and run on the message thread.
+	void SetTimer(const std::string& key, Clock::duration delay, Task task)
+	{
+		m_Timers[key] = Timer{ Clock::now() + delay, std::move(task) };
+	}
+
+	void CancelTimer(const std::string& key) { m_Timers.erase(key); }
+
+	// Runs the timer now instead of when it is due. Returns false if there was no such timer.
+	bool RunTimer(const std::string& key)
+	{
+		auto it = m_Timers.find(key);
+		if (it == m_Timers.end())
+			return false;
+		Task task = std::move(it->second.task);
+		m_Timers.erase(it);
+		task();
+		return true;
+	}
+
+	// Runs all posted tasks and due timers.
+	void RunPending()
+	{
+		std::vector<Task> posted;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			posted.swap(m_Posted);
+		}
+		for (Task& task : posted)
+			task();
+
+		// Timers can set new timers, collect the due ones first.
+		const Clock::time_point now = Clock::now();
+		std::vector<std::string> due;
+		for (const auto& [key, timer] : m_Timers)
+		{
+			if (timer.deadline <= now)
+				due.push_back(key);
+		}
+		for (const std::string& key : due)
+			RunTimer(key);
+	}
+
+	// Runs tasks and timers as they come until 'done' returns true. 'done' is checked on the message thread between tasks.
+	void RunUntil(const std::function<bool()>& done)
+	{
+		while (true)
+		{
+			RunPending();
+			if (done())
+				return;
+
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			if (!m_Posted.empty())
+				continue;
+			if (m_Timers.empty())
+				m_Condition.wait(lock, [this]() { return !m_Posted.empty(); });
+			else
+				m_Condition.wait_until(lock, GetNextDeadline(), [this]() { return !m_Posted.empty(); });
+		}
+	}
+
+private:
+	struct Timer
+	{
+		Clock::time_point deadline;
+		Task task;
+	};
+
+	Clock::time_point GetNextDeadline() const
+	{
+		Clock::time_point next = Clock::time_point::max();
+		for (const auto& [key, timer] : m_Timers)
+			next = timer.deadline < next ? timer.deadline : next;
+		return next;
+	}
+
+private:
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::vector<Task> m_Posted;
+
+	std::unordered_map<std::string, Timer> m_Timers; // Only used on the message thread.
+};
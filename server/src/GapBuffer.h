@@ -1,8 +1,13 @@
 #pragma once
 
 #include <cstdint>
-#include <cstring> // memcpy
+#include <cstring> // memcpy, memmove
 #include <cassert>
+#include <algorithm> // stable_sort
+
+#include "TextEdit.h"
+#include "StorageStats.h"
+#include "BufferAllocator.h"
 
 struct GapBuffer
 {
@@ -11,8 +16,11 @@ public:
 
 	GapBuffer() {}
 
-	GapBuffer(Type* pInitialData, size_t initialCount, size_t initialGapCount)
+	// pAllocator: Where the buffer is allocated from, the shared default allocator if null.
+	GapBuffer(const Type* pInitialData, size_t initialCount, size_t initialGapCount, BufferAllocator* pAllocator = nullptr)
 	{
+		if (pAllocator)
+			m_pAllocator = pAllocator;
 		Init(pInitialData, initialCount, initialGapCount);
 	}
 
@@ -21,11 +29,36 @@ public:
 		Delete();
 	}
 
-	void Create(Type* pInitialData, size_t initialCount, size_t initialGapCount)
+	GapBuffer(const GapBuffer&) = delete;
+	GapBuffer& operator=(const GapBuffer&) = delete;
+
+	void Create(const Type* pInitialData, size_t initialCount, size_t initialGapCount)
 	{
 		Init(pInitialData, initialCount, initialGapCount);
 	}
 
+	// Replaces the content with a copy of another buffer, including its gap.
+	void CopyFrom(const GapBuffer& other)
+	{
+		if (IsInitialized())
+			Delete();
+		if (!other.IsInitialized())
+			return;
+
+		// The block can come back larger than the other buffer, the extra space goes to the gap.
+		m_pAllocator = other.m_pAllocator;
+		m_pBufferStart = m_pAllocator->Allocate(other.m_BufferCount, m_BufferCount);
+		const size_t leftCount = other.CalcLeftCount();
+		const size_t rightCount = other.CalcRightCount();
+		m_GapCount = m_BufferCount - leftCount - rightCount;
+		m_pGapStart = m_pBufferStart + leftCount;
+		std::memcpy(m_pBufferStart, other.m_pBufferStart, sizeof(Type) * leftCount);
+		std::memcpy(m_pGapStart + m_GapCount, other.GetRightData(), sizeof(Type) * rightCount);
+#ifdef MSLP_DEBUG
+		std::memset(m_pGapStart, m_sDebugByte, sizeof(Type) * m_GapCount);
+#endif
+	}
+
 	void Left(size_t steps = 1u)
 	{
 #ifdef MSLP_DEBUG
@@ -49,6 +82,7 @@ public:
 		}
 
 		// Move data
+		MSLP_STORAGE_COPIED(steps);
 		if (steps == 1u)
 		{
 			*(pNewGapStart + m_GapCount) = *pNewGapStart;
@@ -58,16 +92,8 @@ public:
 		}
 		else
 		{
-			// Need to use the scratch buffer if copy paste ranges overlap.
-			if (steps > m_GapCount)
-			{
-				std::memcpy(m_pGapScratchBuffer, pNewGapStart, sizeof(Type) * steps);
-				std::memcpy(pNewGapStart + m_GapCount, m_pGapScratchBuffer, sizeof(Type) * steps);
-			}
-			else
-			{
-				std::memcpy(pNewGapStart + m_GapCount, pNewGapStart, sizeof(Type) * steps);
-			}
+			// Ranges overlap if more steps than the gap size are taken.
+			std::memmove(pNewGapStart + m_GapCount, pNewGapStart, sizeof(Type) * steps);
 #ifdef MSLP_DEBUG
 			std::memset(pNewGapStart, m_sDebugByte, sizeof(Type) * m_GapCount);
 #endif
@@ -84,42 +110,30 @@ public:
 
 		// At the right most position.
 		// 0 1 2 3 4 5 6 7 8 9 | - - - - - |
-		if (m_pGapStart == (m_pBufferStart + m_BufferCount - 1u - m_GapCount - 1u))
+		const size_t rightCount = CalcRightCount();
+		if (rightCount == 0u)
 			return;
 
 		// Move gap position to the right, clamping it to the buffer end position if outside.
-		Type* pNewGapStart = m_pGapStart;
-		const size_t rightCount = CalcRightCount();
-		if (rightCount > steps)
-			pNewGapStart += steps;
-		else
-		{
-			pNewGapStart = m_pBufferStart + m_BufferCount - 1;
+		if (steps > rightCount)
 			steps = rightCount;
-		}
+		Type* pNewGapStart = m_pGapStart + steps;
 
 		// Move data
+		MSLP_STORAGE_COPIED(steps);
 		if (steps == 1u)
 		{
-			*pNewGapStart = *(pNewGapStart + m_GapCount);
+			*m_pGapStart = *(m_pGapStart + m_GapCount);
 #ifdef MSLP_DEBUG
-			*(pNewGapStart + m_GapCount) = m_sDebugByte;
+			*(m_pGapStart + m_GapCount) = m_sDebugByte;
 #endif
 		}
 		else
 		{
-			// Need to use the scratch buffer if copy pase ranges overlap.
-			if (steps > m_GapCount)
-			{
-				std::memcpy(m_pGapScratchBuffer, m_pGapStart + m_GapCount, sizeof(Type) * steps);
-				std::memcpy(m_pGapStart, m_pGapScratchBuffer, sizeof(Type) * steps);
-			}
-			else
-			{
-				std::memcpy(m_pGapStart, m_pGapStart + m_GapCount, sizeof(Type) * steps);
-			}
+			// Ranges overlap if more steps than the gap size are taken.
+			std::memmove(m_pGapStart, m_pGapStart + m_GapCount, sizeof(Type) * steps);
 #ifdef MSLP_DEBUG
-			std::memset(m_pGapStart + m_GapCount, m_sDebugByte, sizeof(Type) * m_GapCount);
+			std::memset(pNewGapStart, m_sDebugByte, sizeof(Type) * m_GapCount);
 #endif
 		}
 
@@ -128,18 +142,21 @@ public:
 
 	// Note: This moves the gap towards the index.
 	// index: The index before it will be inserted. The element at that position will be on the right side of this index after insertion.
-	void Insert(size_t index, Type* pData, size_t dataCount)
+	void Insert(size_t index, const Type* pData, size_t dataCount)
 	{
 #ifdef MSLP_DEBUG
 		assert(IsInitialized());
 #endif
+		if (dataCount == 0u)
+			return;
 
 		// Don't let gap become zero.
 		if (m_GapCount < dataCount + 1u)
-			Grow();
+			Grow(dataCount + 1u);
 
 		MoveTo(index);
 
+		MSLP_STORAGE_COPIED(dataCount);
 		if (dataCount > 1)
 			std::memcpy(m_pGapStart, pData, sizeof(Type) * dataCount);
 		else
@@ -161,14 +178,103 @@ public:
 #ifdef MSLP_DEBUG
 		assert(IsInitialized());
 #endif
+		if (count == 0u)
+			return;
+
 		MoveTo(index);
 		GrowOverlap(count);
 	}
 
+	// Applies a batch of edits in one pass. The gap is grown at most once and only moves towards the end of the buffer.
+	// pEdits: Offsets refer to the buffer before the batch. On return the edits are sorted by start,
+	//         and each start is moved to where the edit was applied, after the edits before it.
+	void ApplyEdits(TextEdit* pEdits, size_t count)
+	{
+#ifdef MSLP_DEBUG
+		assert(IsInitialized());
+#endif
+		if (count == 0u)
+			return;
+
+		std::stable_sort(pEdits, pEdits + count, [](const TextEdit& a, const TextEdit& b) { return a.start < b.start; });
+
+		// The gap needs to fit the largest amount of data that is added at any point during the pass.
+		size_t gapNeeded = 0;
+		size_t added = 0;
+		size_t erased = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+#ifdef MSLP_DEBUG
+			assert((i == 0 || pEdits[i - 1].start + pEdits[i - 1].eraseCount <= pEdits[i].start) && "Edits cannot overlap!");
+			assert(pEdits[i].start + pEdits[i].eraseCount <= GetCount() && "Out of bounds!");
+#endif
+			erased += pEdits[i].eraseCount;
+			added += pEdits[i].dataCount;
+			if (added > erased && added - erased > gapNeeded)
+				gapNeeded = added - erased;
+		}
+		if (m_GapCount < gapNeeded + 1u)
+			Grow(gapNeeded + 1u);
+
+		// 0 1 [2 3] 4 5 [6] 7 8 9
+		// 0 1 A | - - - | 4 5 6 7 8 9    <- First edit, the gap is moved once to it.
+		// 0 1 A 4 5 B C | - - | 7 8 9    <- Following edits only move the gap to the right.
+		MoveTo(pEdits[0].start);
+		size_t shift = 0; // Applied offsets are shifted by the size change of all previous edits.
+		for (size_t i = 0; i < count; ++i)
+		{
+			TextEdit& edit = pEdits[i];
+			edit.start = edit.start + shift;
+			Right(edit.start - CalcLeftCount());
+
+			GrowOverlap(edit.eraseCount);
+			if (edit.dataCount > 0)
+			{
+				MSLP_STORAGE_COPIED(edit.dataCount);
+				std::memcpy(m_pGapStart, edit.pData, sizeof(Type) * edit.dataCount);
+				m_pGapStart += edit.dataCount;
+				m_GapCount -= edit.dataCount;
+			}
+
+			shift = shift + edit.dataCount - edit.eraseCount;
+		}
+	}
+
+	// Number of elements stored, excluding the gap.
+	size_t GetCount() const { return m_BufferCount - m_GapCount; }
+
+	// The data is stored as two spans, one on each side of the gap:
+	// [Left] | - - - - | [Right]
+	const Type* GetLeftData() const { return m_pBufferStart; }
+	size_t GetLeftCount() const { return CalcLeftCount(); }
+	const Type* GetRightData() const { return m_pGapStart + m_GapCount; }
+	size_t GetRightCount() const { return CalcRightCount(); }
+
+	// index: Index which does not include the gap.
+	Type At(size_t index) const
+	{
+#ifdef MSLP_DEBUG
+		assert(index < GetCount() && "Out of bounds!");
+#endif
+		const size_t leftCount = CalcLeftCount();
+		return index < leftCount ? m_pBufferStart[index] : m_pGapStart[m_GapCount + index - leftCount];
+	}
+
+	// Copies all elements, without the gap, into pDest. pDest needs to fit GetCount() elements.
+	void CopyTo(Type* pDest) const
+	{
+		const size_t leftCount = CalcLeftCount();
+		const size_t rightCount = CalcRightCount();
+		if (leftCount > 0)
+			std::memcpy(pDest, m_pBufferStart, sizeof(Type) * leftCount);
+		if (rightCount > 0)
+			std::memcpy(pDest + leftCount, m_pGapStart + m_GapCount, sizeof(Type) * rightCount);
+	}
+
 private:
 	// Moves gap such that the start of the gap is where the index pointed to.
 	// Index does not include the gap:
-	// 0 1 2 | - - - - | 3 4 5 
+	// 0 1 2 | - - - - | 3 4 5
 	void MoveTo(size_t index)
 	{
 #ifdef MSLP_DEBUG
@@ -180,19 +286,19 @@ private:
 
 		// BufferStart         BufferEnd
 		// |                       |
-		// 0 1 2 | - - - - | 3 4 5 
+		// 0 1 2 | - - - - | 3 4 5
 		//         ^         ^
 		//     GapStart    GapEnd
 
 		// Index
-		// 0 1 2 | - - - - | 3 4 5 
+		// 0 1 2 | - - - - | 3 4 5
 		// BufferIndex
-		// 0 1 2 | 3 4 5 6 | 7 8 9 
+		// 0 1 2 | 3 4 5 6 | 7 8 9
 
 		// Move the gap such that 'BufferIndex' is at the start of the gap:
-		//    BufferIndex          
-		//         |               
-		// 0 1 2 | - - - - | 3 4 5 
+		//    BufferIndex
+		//         |
+		// 0 1 2 | - - - - | 3 4 5
 
 		if (onLeftSide)
 		{
@@ -208,27 +314,22 @@ private:
 
 	// Grows the gap without disrupting the data.
 	// (Expensive due to it needing to copy all 'left' and 'right' data over to new buffer!)
-	void Grow()
+	// minGapCount: The gap will be at least this large after growing.
+	void Grow(size_t minGapCount)
 	{
-		// 0 1 2 | - - | 3 4 5 
-		// After Grow (grow factor of 2):
-		// 0 1 2 | - - - - - - - - - - | 3 4 5 
-
-		const size_t newSize = m_BufferCount * m_sGrowSizeFactor;
-		Type* pNewBuffer = new Type[newSize];
+		// 0 1 2 | - - | 3 4 5
+		// After Grow (buffer doubled):
+		// 0 1 2 | - - - - - - - - - - | 3 4 5
 
 		const size_t leftSize = (size_t)(m_pGapStart - m_pBufferStart);
 		const size_t rightSize = m_BufferCount - leftSize - m_GapCount;
+
+		size_t newSize = 0;
+		Type* pNewBuffer = m_pAllocator->Allocate(BufferAllocator::GetGrowCount(m_BufferCount, leftSize + rightSize + minGapCount), newSize);
+
 		const size_t newGapSize = newSize - leftSize - rightSize;
 
-		// Update scratch buffer size
-		if (newGapSize > m_GapCapacity)
-		{
-			if (m_pGapScratchBuffer)
-				delete[] m_pGapScratchBuffer;
-			m_pGapScratchBuffer = new Type[m_GapCount];
-			m_GapCapacity = m_GapCount;
-		}
+		MSLP_STORAGE_COPIED(leftSize + rightSize);
 
 		// Copy Left buffer
 		std::memcpy(pNewBuffer, m_pBufferStart, sizeof(Type) * leftSize);
@@ -237,7 +338,7 @@ private:
 		std::memcpy(pNewBuffer + leftSize + newGapSize, m_pGapStart + m_GapCount, sizeof(Type) * rightSize);
 
 		// Update stored data pointers.
-		delete[] m_pBufferStart;
+		m_pAllocator->Free(m_pBufferStart, m_BufferCount);
 		m_pBufferStart = pNewBuffer;
 		m_BufferCount = newSize;
 
@@ -253,45 +354,33 @@ private:
 	// Grows the gap without copying data. This will 'erase' some data that was after the gap.
 	void GrowOverlap(size_t extraCount)
 	{
-		// 0 1 2 | - - - - | 3 4 5 
+		// 0 1 2 | - - - - | 3 4 5
 		// ExtraCount = 2:
-		// 0 1 2 | - - - - 3 4 | 5 
+		// 0 1 2 | - - - - 3 4 | 5
 
 #ifdef MSLP_DEBUG
-		assert(extraCount <= (m_BufferCount - m_GapCount) && "Cannot erase more elements than the total amount!");
+		assert(extraCount <= CalcRightCount() && "Cannot erase more elements than there are after the gap!");
 		std::memset(m_pGapStart + m_GapCount, m_sDebugByte, sizeof(Type) * extraCount);
 #endif
 		m_GapCount += extraCount;
-
-		if (m_GapCount > m_GapCapacity)
-		{
-			if (m_pGapScratchBuffer)
-				delete[] m_pGapScratchBuffer;
-			m_pGapScratchBuffer = new Type[m_GapCount];
-			m_GapCapacity = m_GapCount;
-		}
 	}
 
-	void Init(Type* pInitialData, size_t initialCount, size_t initialGapCount)
+	void Init(const Type* pInitialData, size_t initialCount, size_t initialGapCount)
 	{
 		// Delete old data
-		if (!IsInitialized())
+		if (IsInitialized())
 			Delete();
 
 #ifdef MSLP_DEBUG
 		assert(initialGapCount != 0 && "Cannot initialize an empty gap!");
-		assert((pInitialData == nullptr && initialCount == 0) || (pInitialData != nullptr && initialCount > 0) && "pInitialData need to match the initialCount!");
+		assert(((pInitialData == nullptr && initialCount == 0) || (pInitialData != nullptr && initialCount > 0)) && "pInitialData need to match the initialCount!");
 #endif
 
-		m_BufferCount = initialCount + initialGapCount;
-		m_pBufferStart = new Type[m_BufferCount];
+		m_pBufferStart = m_pAllocator->Allocate(initialCount + initialGapCount, m_BufferCount);
 
-		m_GapCount = initialGapCount;
+		m_GapCount = m_BufferCount - initialCount;
 		m_pGapStart = m_pBufferStart;
 
-		m_pGapScratchBuffer = new Type[m_GapCount];
-		m_GapCapacity = m_GapCount;
-
 		// Copy data
 		if (initialCount > 0 && pInitialData)
 		{
@@ -310,19 +399,12 @@ private:
 	{
 		if (m_pBufferStart)
 		{
-			delete[] m_pBufferStart;
+			m_pAllocator->Free(m_pBufferStart, m_BufferCount);
 			m_pBufferStart = nullptr;
 			m_BufferCount = 0;
 		}
 		m_pGapStart = nullptr;
 		m_GapCount = 0;
-
-		if (m_pGapScratchBuffer)
-		{
-			delete[] m_pGapScratchBuffer;
-			m_pGapScratchBuffer = nullptr;
-			m_GapCapacity = 0;
-		}
 	}
 
 	size_t CalcLeftCount() const { return (size_t)(m_pGapStart - m_pBufferStart); }
@@ -331,17 +413,15 @@ private:
 	bool IsInitialized() const { return m_pBufferStart != nullptr; }
 
 private:
-	inline static const uint32_t m_sGrowSizeFactor = 2;
 #ifdef MSLP_DEBUG
 	inline static constexpr uint8_t m_sDebugByte = 0xFF;
 #endif
 
+	BufferAllocator* m_pAllocator = &BufferAllocator::GetDefault();
+
 	Type* m_pBufferStart = nullptr;
 	size_t m_BufferCount = 0;
 
 	Type* m_pGapStart = nullptr;
 	size_t m_GapCount = 0;
-
-	Type* m_pGapScratchBuffer = nullptr; // Used for storing data that should be copied.
-	size_t m_GapCapacity = 0;
-};
\ No newline at end of file
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "TextStorage.h"
+#include "GapBuffer.h"
+
+// TextStorage backed by a GapBuffer.
+struct GapBufferStorage : public TextStorage
+{
+public:
+	GapBufferStorage(const Type* pInitialData, size_t initialCount, size_t initialGapCount, BufferAllocator* pAllocator = nullptr)
+		: m_Buffer(initialCount > 0 ? pInitialData : nullptr, initialCount, initialGapCount, pAllocator) {}
+
+	void Insert(size_t index, const Type* pData, size_t dataCount) override { m_Buffer.Insert(index, pData, dataCount); }
+	void Erase(size_t index, size_t count) override { m_Buffer.Erase(index, count); }
+	void ApplyEdits(TextEdit* pEdits, size_t count) override { m_Buffer.ApplyEdits(pEdits, count); }
+
+	size_t GetCount() const override { return m_Buffer.GetCount(); }
+	Type At(size_t index) const override { return m_Buffer.At(index); }
+
+	// The chunks are the spans on each side of the gap.
+	size_t GetChunk(size_t index, const Type*& pOutData) const override
+	{
+		const size_t leftCount = m_Buffer.GetLeftCount();
+		if (index < leftCount)
+		{
+			pOutData = m_Buffer.GetLeftData() + index;
+			return leftCount - index;
+		}
+
+		const size_t rightIndex = index - leftCount;
+		if (rightIndex < m_Buffer.GetRightCount())
+		{
+			pOutData = m_Buffer.GetRightData() + rightIndex;
+			return m_Buffer.GetRightCount() - rightIndex;
+		}
+
+		pOutData = nullptr;
+		return 0;
+	}
+
+	void CopyTo(Type* pDest) const override { m_Buffer.CopyTo(pDest); }
+
+	TextStorageKind GetKind() const override { return TextStorageKind::GapBuffer; }
+
+	std::unique_ptr<TextStorage> Clone() const override
+	{
+		std::unique_ptr<GapBufferStorage> pClone(new GapBufferStorage());
+		pClone->m_Buffer.CopyFrom(m_Buffer);
+		return pClone;
+	}
+
+	GapBuffer& GetGapBuffer() { return m_Buffer; }
+	const GapBuffer& GetGapBuffer() const { return m_Buffer; }
+
+private:
+	GapBufferStorage() {}
+
+	GapBuffer m_Buffer;
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <format>
+
+// Escapes the text for a JSON string.
+inline std::string EscapeJson(std::string_view text)
+{
+	std::string escaped;
+	escaped.reserve(text.size() + 16);
+	for (const char c : text)
+	{
+		switch (c)
+		{
+		case '"': escaped += "\\\""; break;
+		case '\\': escaped += "\\\\"; break;
+		case '\n': escaped += "\\n"; break;
+		case '\r': escaped += "\\r"; break;
+		case '\t': escaped += "\\t"; break;
+		default:
+			if ((unsigned char)c < 0x20)
+				escaped += std::format("\\u{:04x}", (unsigned int)(unsigned char)c);
+			else
+				escaped += c;
+			break;
+		}
+	}
+	return escaped;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <bit>
+#include <format>
+#include <string>
+#include <cstdint>
+
+// Counts durations in log-linear buckets, like HdrHistogram: every power of two is split into m_sSubBucketCount buckets,
+// so percentiles are within 1/m_sSubBucketCount of the real value from a nanosecond up to 18 minutes, with a fixed amount of memory:
+//
+// [0][1]...[15] | [16]...[31] | [32,33]...[62,63] | [64..67]...[124..127] | ...
+//
+// Record can be called from any thread.
+struct LatencyHistogram
+{
+public:
+	LatencyHistogram() = default;
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	void Record(std::chrono::nanoseconds duration)
+	{
+		const uint64_t value = (uint64_t)std::max<int64_t>(0, duration.count());
+		m_Counts[GetBucket(value)].fetch_add(1, std::memory_order_relaxed);
+		m_Count.fetch_add(1, std::memory_order_relaxed);
+		m_Sum.fetch_add(value, std::memory_order_relaxed);
+
+		uint64_t max = m_Max.load(std::memory_order_relaxed);
+		while (value > max && !m_Max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+	}
+
+	uint64_t GetCount() const { return m_Count.load(std::memory_order_relaxed); }
+	std::chrono::nanoseconds GetMax() const { return std::chrono::nanoseconds(m_Max.load(std::memory_order_relaxed)); }
+
+	std::chrono::nanoseconds GetMean() const
+	{
+		const uint64_t count = GetCount();
+		return std::chrono::nanoseconds(count > 0 ? m_Sum.load(std::memory_order_relaxed) / count : 0);
+	}
+
+	// percentile: In [0, 1], 0.99 for p99. Returns the highest value of the bucket it falls in, never more than the max.
+	std::chrono::nanoseconds GetPercentile(double percentile) const
+	{
+		const uint64_t count = GetCount();
+		if (count == 0)
+			return std::chrono::nanoseconds(0);
+
+		const uint64_t rank = std::max<uint64_t>(1, (uint64_t)(percentile * (double)count + 0.5));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < m_sBucketCount; ++i)
+		{
+			seen += m_Counts[i].load(std::memory_order_relaxed);
+			if (seen >= rank)
+				return std::min(std::chrono::nanoseconds(GetBucketMax(i)), GetMax());
+		}
+		return GetMax();
+	}
+
+	// {"count":12,"mean":10.5,"p50":8.2,"p99":40.1,"p999":40.1,"max":41.0} in microseconds.
+	std::string ToJson() const
+	{
+		return std::format(R"({{"count":{},"mean":{:.1f},"p50":{:.1f},"p99":{:.1f},"p999":{:.1f},"max":{:.1f}}})",
+			GetCount(), ToMicroseconds(GetMean()), ToMicroseconds(GetPercentile(0.5)), ToMicroseconds(GetPercentile(0.99)),
+			ToMicroseconds(GetPercentile(0.999)), ToMicroseconds(GetMax()));
+	}
+
+	static double ToMicroseconds(std::chrono::nanoseconds duration) { return (double)duration.count() / 1000.0; }
+
+private:
+	static size_t GetBucket(uint64_t value)
+	{
+		if (value < m_sSubBucketCount)
+			return (size_t)value;
+		const uint32_t shift = (uint32_t)std::bit_width(value) - 1 - m_sSubBucketBits;
+		const size_t bucket = (shift + 1) * m_sSubBucketCount + (size_t)((value >> shift) - m_sSubBucketCount);
+		return std::min(bucket, m_sBucketCount - 1);
+	}
+
+	static uint64_t GetBucketMax(size_t bucket)
+	{
+		if (bucket < m_sSubBucketCount)
+			return bucket;
+		const uint32_t shift = (uint32_t)(bucket / m_sSubBucketCount) - 1;
+		const uint64_t subBucket = bucket % m_sSubBucketCount + m_sSubBucketCount;
+		return ((subBucket + 1) << shift) - 1;
+	}
+
+private:
+	inline static constexpr uint32_t m_sSubBucketBits = 4;
+	inline static constexpr size_t m_sSubBucketCount = (size_t)1 << m_sSubBucketBits;
+	inline static constexpr uint32_t m_sMaxValueBits = 40; // 2^40 ns, about 18 minutes.
+	inline static constexpr size_t m_sBucketCount = (m_sMaxValueBits - m_sSubBucketBits + 1) * m_sSubBucketCount;
+
+	std::atomic<uint64_t> m_Counts[m_sBucketCount] = {};
+	std::atomic<uint64_t> m_Count = 0;
+	std::atomic<uint64_t> m_Sum = 0;
+	std::atomic<uint64_t> m_Max = 0;
+};
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+#include "TextStorage.h"
+#include "TextScan.h"
+
+// How the character of a LSP position is counted.
+enum class PositionEncoding
+{
+	UTF16,	// Default of the protocol.
+	UTF8,	// Negotiated through 'positionEncoding', the character is the byte offset into the line.
+};
+
+// Start offset of every line of a document, kept up to date on each edit.
+// Lines are kept in a balanced tree (an implicit treap ordered by line) which stores the byte length of each line,
+// so converting between a line and a byte offset is O(log lines).
+// A line ends after its '\n', the last line has no '\n' and can be empty.
+struct LineIndex
+{
+public:
+	LineIndex() {}
+
+	// Rebuilds the index from the whole text.
+	void Build(const TextStorage& storage)
+	{
+		m_Nodes.clear();
+		m_FreeNodes.clear();
+		m_Nodes.reserve(TextScan::CountNewlines(storage, 0, storage.GetCount()) + 1);
+		m_Root = ScanLines(storage, 0, storage.GetCount(), true);
+	}
+
+	// Updates the lines touched by an edit. Must be called after the edit was applied to the storage.
+	// startByte, oldEndByte: The replaced range, in offsets from before the edit.
+	// newEndByte: End of the inserted text, in offsets from after the edit.
+	void Edit(const TextStorage& storage, size_t startByte, size_t oldEndByte, size_t newEndByte)
+	{
+		// Every line that the old range touched is replaced.
+		// [ line 3 ][ line 4 ][ line 5 ]
+		//       ^ start           ^ old end
+		// |<------------ region --------->|
+		const uint32_t startLine = LineAt(startByte);
+		const uint32_t endLine = LineAt(oldEndByte);
+		const size_t regionStart = LineStart(startLine);
+		const size_t regionOldEnd = LineStart(endLine) + LineLength(endLine);
+		const size_t regionNewEnd = regionOldEnd - oldEndByte + newEndByte;
+		const bool includesLastLine = endLine + 1 == GetLineCount();
+
+		uint32_t left, middle, right;
+		SplitLines(m_Root, startLine, left, right);
+		SplitLines(right, endLine - startLine + 1, middle, right);
+		FreeSubtree(middle);
+
+		// The region always ends with a '\n', unless it runs to the end of the text where the last line has none.
+		const uint32_t lines = ScanLines(storage, regionStart, regionNewEnd, includesLastLine);
+		m_Root = Merge(Merge(left, lines), right);
+	}
+
+	// Updates the lines touched by a batch of edits. Must be called after TextStorage::ApplyEdits applied them.
+	// Edits that touch the same lines are rescanned together, the lines between the groups are left alone,
+	// so a batch spread over the whole text (a formatter, replace all) does not rescan everything between its first and last edit.
+	// pEdits: As returned by ApplyEdits, sorted and each start in offsets from after the edits before it.
+	void EditBatch(const TextStorage& storage, const TextEdit* pEdits, size_t count)
+	{
+		// First and last edit of a group, found on the index as it was before the batch.
+		struct Group
+		{
+			size_t first;
+			size_t last;
+		};
+
+		std::vector<Group> groups;
+		size_t shift = 0; // Wraps around when text was removed, the sums still come out right.
+		uint32_t groupEndLine = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const size_t oldStart = pEdits[i].start - shift;
+			const uint32_t startLine = LineAt(oldStart);
+			const uint32_t endLine = LineAt(oldStart + pEdits[i].eraseCount);
+			if (!groups.empty() && startLine <= groupEndLine)
+			{
+				groups.back().last = i;
+				groupEndLine = std::max(groupEndLine, endLine);
+			}
+			else
+			{
+				groups.push_back(Group{ i, i });
+				groupEndLine = endLine;
+			}
+			shift += pEdits[i].dataCount - pEdits[i].eraseCount;
+		}
+
+		// When a group is updated, the lines before it are already up to date and the ones after it are still the old ones, moved by the groups before it.
+		shift = 0;
+		size_t edit = 0;
+		for (const Group& group : groups)
+		{
+			const size_t groupShift = shift;
+			for (; edit < group.last; ++edit)
+				shift += pEdits[edit].dataCount - pEdits[edit].eraseCount;
+			const TextEdit& last = pEdits[group.last];
+			const size_t oldEnd = last.start - shift + groupShift + last.eraseCount;
+			Edit(storage, pEdits[group.first].start, oldEnd, last.start + last.dataCount);
+			shift += last.dataCount - last.eraseCount;
+			edit = group.last + 1;
+		}
+	}
+
+	uint32_t GetLineCount() const { return SubtreeLines(m_Root); }
+
+	// Returns the line that the byte offset is on. Offsets past the end are on the last line.
+	uint32_t LineAt(size_t offset) const
+	{
+		uint32_t line = 0;
+		uint32_t node = m_Root;
+		while (node != m_sNull)
+		{
+			const Node& n = m_Nodes[node];
+			const size_t leftLength = SubtreeLength(n.left);
+			if (offset < leftLength)
+				node = n.left;
+			else if (offset < leftLength + n.length || n.right == m_sNull)
+				return line + SubtreeLines(n.left);
+			else
+			{
+				offset -= leftLength + n.length;
+				line += SubtreeLines(n.left) + 1;
+				node = n.right;
+			}
+		}
+		return line > 0 ? line - 1 : 0;
+	}
+
+	// Byte offset of the first character of the line.
+	size_t LineStart(uint32_t line) const
+	{
+		size_t offset = 0;
+		const uint32_t node = FindLine(line, &offset);
+		return node != m_sNull ? offset : SubtreeLength(m_Root);
+	}
+
+	// Byte length of the line, including its '\n'.
+	size_t LineLength(uint32_t line) const
+	{
+		const uint32_t node = FindLine(line, nullptr);
+		return node != m_sNull ? m_Nodes[node].length : 0;
+	}
+
+	// True if the line only contains ASCII characters, where UTF-16 and UTF-8 offsets are the same.
+	bool IsLineAscii(uint32_t line) const
+	{
+		const uint32_t node = FindLine(line, nullptr);
+		return node == m_sNull || m_Nodes[node].ascii;
+	}
+
+	// Converts a position to a byte offset. Characters past the end of the line are clamped to it.
+	size_t PositionToOffset(const TextStorage& storage, uint32_t line, uint32_t character, PositionEncoding encoding) const
+	{
+		if (line >= GetLineCount())
+			return storage.GetCount();
+
+		size_t lineStart = 0;
+		const Node& n = m_Nodes[FindLine(line, &lineStart)];
+		const size_t textLength = n.length > 0 && line + 1 < GetLineCount() ? n.length - 1 : n.length; // Without the '\n'.
+
+		if (encoding == PositionEncoding::UTF8 || n.ascii)
+			return lineStart + (character < textLength ? character : textLength);
+
+		// Walk the UTF-8 sequences of the line, counting UTF-16 code units.
+		size_t offset = lineStart;
+		const size_t lineEnd = lineStart + textLength;
+		uint32_t units = 0;
+		while (units < character && offset < lineEnd)
+		{
+			const TextStorage::Type byte = storage.At(offset);
+			if (byte < 0x80) { offset += 1; units += 1; }
+			else if (byte < 0xE0) { offset += 2; units += 1; }
+			else if (byte < 0xF0) { offset += 3; units += 1; }
+			else { offset += 4; units += 2; }
+		}
+		return offset < lineEnd ? offset : lineEnd;
+	}
+
+	// Converts a byte offset to a line and character.
+	void OffsetToPosition(const TextStorage& storage, size_t offset, PositionEncoding encoding, uint32_t& outLine, uint32_t& outCharacter) const
+	{
+		outLine = LineAt(offset);
+		const size_t lineStart = LineStart(outLine);
+		if (encoding == PositionEncoding::UTF8 || IsLineAscii(outLine))
+		{
+			outCharacter = (uint32_t)(offset - lineStart);
+			return;
+		}
+
+		// Count UTF-16 code units up to the offset. Continuation bytes (10xxxxxx) do not start a new code point.
+		uint32_t units = 0;
+		for (size_t i = lineStart; i < offset; ++i)
+		{
+			const TextStorage::Type byte = storage.At(i);
+			if ((byte & 0xC0) != 0x80)
+				units += byte >= 0xF0 ? 2 : 1;
+		}
+		outCharacter = units;
+	}
+
+private:
+	struct Node
+	{
+		uint32_t length = 0;			// Bytes in the line, including the '\n'.
+		uint32_t subtreeLength = 0;		// Bytes in this line and all lines below it.
+		uint32_t subtreeLines = 0;		// Number of lines in this subtree.
+		uint32_t priority = 0;			// Treap priority, a parent always has a higher priority than its children.
+		uint32_t left = m_sNull;
+		uint32_t right = m_sNull;
+		bool ascii = true;
+	};
+
+	// Creates the lines of the text in [start, end) and returns them as a tree.
+	// includesLastLine: The range runs to the end of the text, which always ends with a line without a '\n'.
+	uint32_t ScanLines(const TextStorage& storage, size_t start, size_t end, bool includesLastLine)
+	{
+		uint32_t root = m_sNull;
+		uint32_t length = 0;
+		bool ascii = true;
+
+		size_t offset = start;
+		const TextStorage::Type* pChunk = nullptr;
+		while (offset < end)
+		{
+			size_t chunkCount = storage.GetChunk(offset, pChunk);
+			if (chunkCount == 0)
+				break;
+			if (chunkCount > end - offset)
+				chunkCount = end - offset;
+
+			size_t i = 0;
+			while (i < chunkCount)
+			{
+				const size_t newline = i + TextScan::FindNewline(pChunk + i, chunkCount - i);
+				const size_t segmentEnd = newline < chunkCount ? newline + 1 : chunkCount;
+				length += (uint32_t)(segmentEnd - i);
+				ascii = ascii && TextScan::IsAscii(pChunk + i, segmentEnd - i);
+				i = segmentEnd;
+
+				if (newline < chunkCount)
+				{
+					root = Merge(root, NewNode(length, ascii));
+					length = 0;
+					ascii = true;
+				}
+			}
+			offset += chunkCount;
+		}
+
+		// The last line of the text has no '\n'.
+		if (length > 0 || includesLastLine)
+			root = Merge(root, NewNode(length, ascii));
+		return root;
+	}
+
+	// Returns the node of the line and the byte offset of its start through pOutStart.
+	uint32_t FindLine(uint32_t line, size_t* pOutStart) const
+	{
+		size_t start = 0;
+		uint32_t node = m_Root;
+		while (node != m_sNull)
+		{
+			const Node& n = m_Nodes[node];
+			const uint32_t leftLines = SubtreeLines(n.left);
+			if (line < leftLines)
+				node = n.left;
+			else if (line == leftLines)
+			{
+				start += SubtreeLength(n.left);
+				break;
+			}
+			else
+			{
+				line -= leftLines + 1;
+				start += SubtreeLength(n.left) + n.length;
+				node = n.right;
+			}
+		}
+
+		if (pOutStart)
+			*pOutStart = start;
+		return node;
+	}
+
+	// Splits the tree such that the first 'lineCount' lines end up in outLeft and the rest in outRight.
+	void SplitLines(uint32_t node, uint32_t lineCount, uint32_t& outLeft, uint32_t& outRight)
+	{
+		if (node == m_sNull)
+		{
+			outLeft = outRight = m_sNull;
+			return;
+		}
+
+		const uint32_t leftLines = SubtreeLines(m_Nodes[node].left);
+		if (lineCount <= leftLines)
+		{
+			uint32_t newLeft;
+			SplitLines(m_Nodes[node].left, lineCount, outLeft, newLeft);
+			m_Nodes[node].left = newLeft;
+			Update(node);
+			outRight = node;
+		}
+		else
+		{
+			uint32_t newRight;
+			SplitLines(m_Nodes[node].right, lineCount - leftLines - 1, newRight, outRight);
+			m_Nodes[node].right = newRight;
+			Update(node);
+			outLeft = node;
+		}
+	}
+
+	// Joins two trees where all of 'left' comes before all of 'right'.
+	uint32_t Merge(uint32_t left, uint32_t right)
+	{
+		if (left == m_sNull)
+			return right;
+		if (right == m_sNull)
+			return left;
+
+		if (m_Nodes[left].priority > m_Nodes[right].priority)
+		{
+			const uint32_t merged = Merge(m_Nodes[left].right, right);
+			m_Nodes[left].right = merged;
+			Update(left);
+			return left;
+		}
+
+		const uint32_t merged = Merge(left, m_Nodes[right].left);
+		m_Nodes[right].left = merged;
+		Update(right);
+		return right;
+	}
+
+	void Update(uint32_t node)
+	{
+		Node& n = m_Nodes[node];
+		n.subtreeLength = SubtreeLength(n.left) + n.length + SubtreeLength(n.right);
+		n.subtreeLines = SubtreeLines(n.left) + 1 + SubtreeLines(n.right);
+	}
+
+	uint32_t SubtreeLength(uint32_t node) const { return node != m_sNull ? m_Nodes[node].subtreeLength : 0; }
+	uint32_t SubtreeLines(uint32_t node) const { return node != m_sNull ? m_Nodes[node].subtreeLines : 0; }
+
+	uint32_t NewNode(uint32_t length, bool ascii)
+	{
+		uint32_t node;
+		if (!m_FreeNodes.empty())
+		{
+			node = m_FreeNodes.back();
+			m_FreeNodes.pop_back();
+		}
+		else
+		{
+			node = (uint32_t)m_Nodes.size();
+			m_Nodes.emplace_back();
+		}
+
+		Node& n = m_Nodes[node];
+		n.length = length;
+		n.subtreeLength = length;
+		n.subtreeLines = 1;
+		n.priority = NextPriority();
+		n.left = m_sNull;
+		n.right = m_sNull;
+		n.ascii = ascii;
+		return node;
+	}
+
+	void FreeSubtree(uint32_t node)
+	{
+		if (node == m_sNull)
+			return;
+		FreeSubtree(m_Nodes[node].left);
+		FreeSubtree(m_Nodes[node].right);
+		m_FreeNodes.push_back(node);
+	}
+
+	// Xorshift, the priorities only need to be well spread.
+	uint32_t NextPriority()
+	{
+		m_PriorityState ^= m_PriorityState << 13;
+		m_PriorityState ^= m_PriorityState >> 17;
+		m_PriorityState ^= m_PriorityState << 5;
+		return m_PriorityState;
+	}
+
+private:
+	inline static constexpr uint32_t m_sNull = UINT32_MAX;
+
+	std::vector<Node> m_Nodes;
+	std::vector<uint32_t> m_FreeNodes;
+	uint32_t m_Root = m_sNull;
+	uint32_t m_PriorityState = 0x9E3779B9u;
+};
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <format>
+
+#include "Trace.h"
+
+enum class LogLevel : int
+{
+	Trace,
+	Debug,
+	Info,
+	Warning,
+	Error,
+	Off,
+};
+
+enum class LogCategory : uint32_t
+{
+	Server,		// Startup, configuration and the connection.
+	Documents,	// Opening, editing and closing documents.
+	Parser,		// Parses and their results.
+	Requests,	// Request handling.
+	Count,
+};
+
+// Logs from any thread. Messages are handed to a background thread, which rate limits them and passes them on to the sink,
+// the window/logMessage notification of the client in the server.
+// Use MSLP_LOG, which only formats the message if its level and category are enabled, so disabled logs cost a branch.
+struct Logger
+{
+public:
+	using Sink = std::function<void(LogLevel level, LogCategory category, const std::string& message)>;
+
+	// Only one logger exists at a time, MSLP_LOG writes to the most recently created one.
+	Logger(Sink sink) : m_Sink(std::move(sink))
+	{
+		m_Thread = std::thread(&Logger::Run, this);
+		m_sInstance.store(this);
+	}
+
+	// Sends what is still queued before returning.
+	~Logger()
+	{
+		m_sInstance.store(nullptr);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Condition.notify_one();
+		m_Thread.join();
+	}
+
+	Logger(const Logger&) = delete;
+	Logger& operator=(const Logger&) = delete;
+
+	static bool IsEnabled(LogLevel level, LogCategory category)
+	{
+		return (int)level >= m_sLevel.load(std::memory_order_relaxed) && (m_sCategories.load(std::memory_order_relaxed) & (1u << (uint32_t)category)) != 0;
+	}
+
+	static void SetLevel(LogLevel level) { m_sLevel.store((int)level, std::memory_order_relaxed); }
+	static void SetCategories(uint32_t mask) { m_sCategories.store(mask, std::memory_order_relaxed); }
+
+	static void Write(LogLevel level, LogCategory category, std::string message)
+	{
+		Logger* pLogger = m_sInstance.load();
+		if (pLogger == nullptr)
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(pLogger->m_Mutex);
+			pLogger->m_Queue.push_back(Record{ level, category, std::move(message) });
+		}
+		pLogger->m_Condition.notify_one();
+	}
+
+	static const char* GetCategoryName(LogCategory category)
+	{
+		switch (category)
+		{
+		case LogCategory::Server: return "server";
+		case LogCategory::Documents: return "documents";
+		case LogCategory::Parser: return "parser";
+		case LogCategory::Requests: return "requests";
+		default: return "unknown";
+		}
+	}
+
+	// Parses "trace", "debug", "info", "warning", "error" or "off". Returns false for anything else.
+	static bool ParseLevel(std::string_view name, LogLevel& outLevel)
+	{
+		static const char* s_Names[] = { "trace", "debug", "info", "warning", "error", "off" };
+		for (int i = 0; i <= (int)LogLevel::Off; ++i)
+		{
+			if (name == s_Names[i])
+			{
+				outLevel = (LogLevel)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Parses a comma separated list of category names into a mask for SetCategories.
+	static uint32_t ParseCategories(std::string_view names)
+	{
+		uint32_t mask = 0;
+		while (!names.empty())
+		{
+			const size_t end = names.find(',');
+			const std::string_view name = names.substr(0, end);
+			for (uint32_t i = 0; i < (uint32_t)LogCategory::Count; ++i)
+			{
+				if (name == GetCategoryName((LogCategory)i))
+					mask |= 1u << i;
+			}
+			names = end == std::string_view::npos ? std::string_view() : names.substr(end + 1);
+		}
+		return mask;
+	}
+
+private:
+	struct Record
+	{
+		LogLevel level;
+		LogCategory category;
+		std::string message;
+	};
+
+	void Run()
+	{
+		MSLP_TRACE_THREAD("Logger");
+		std::vector<Record> records;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [this]() { return m_Stop || !m_Queue.empty(); });
+				if (m_Queue.empty() && m_Stop)
+					break;
+				records.swap(m_Queue);
+			}
+
+			for (Record& record : records)
+			{
+				// Errors always get through, they are what is needed to debug a problem.
+				if (record.level < LogLevel::Error && !TakeToken())
+				{
+					m_DroppedCount++;
+					continue;
+				}
+				ReportDropped();
+				m_Sink(record.level, record.category, record.message);
+			}
+			records.clear();
+		}
+	}
+
+	// Token bucket: bursts of up to m_sBurstCount messages, then m_sMessagesPerSecond.
+	bool TakeToken()
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		const double seconds = std::chrono::duration<double>(now - m_LastRefill).count();
+		m_LastRefill = now;
+		m_Tokens = std::min((double)m_sBurstCount, m_Tokens + seconds * m_sMessagesPerSecond);
+		if (m_Tokens < 1.0)
+			return false;
+		m_Tokens -= 1.0;
+		return true;
+	}
+
+	void ReportDropped()
+	{
+		if (m_DroppedCount == 0)
+			return;
+		m_Sink(LogLevel::Warning, LogCategory::Server, std::format("Dropped {} log messages, more than {} per second were logged", m_DroppedCount, m_sMessagesPerSecond));
+		m_DroppedCount = 0;
+	}
+
+private:
+	inline static constexpr size_t m_sBurstCount = 200;
+	inline static constexpr size_t m_sMessagesPerSecond = 50;
+
+	inline static std::atomic<Logger*> m_sInstance = nullptr;
+	inline static std::atomic<int> m_sLevel = (int)LogLevel::Info;
+	inline static std::atomic<uint32_t> m_sCategories = ~0u;
+
+	Sink m_Sink;
+	std::thread m_Thread;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::vector<Record> m_Queue;
+	bool m_Stop = false;
+
+	// Only used on the logger thread.
+	double m_Tokens = (double)m_sBurstCount;
+	std::chrono::steady_clock::time_point m_LastRefill = std::chrono::steady_clock::now();
+	size_t m_DroppedCount = 0;
+};
+
+// MSLP_LOG(LogLevel::Info, LogCategory::Documents, "Opened {}", uri);
+#define MSLP_LOG(level, category, ...) \
+	do { if (Logger::IsEnabled(level, category)) Logger::Write(level, category, std::format(__VA_ARGS__)); } while (false)
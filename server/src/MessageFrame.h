@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+
+// JSON-RPC frames as they are sent over stdio, a header and a body separated by an empty line:
+//
+// Content-Length: 52\r\n
+// \r\n
+// {"jsonrpc":"2.0","method":"initialized","params":{}}
+namespace MessageFrame
+{
+	// Case insensitive, header names are.
+	inline bool StartsWithIgnoreCase(std::string_view text, std::string_view prefix)
+	{
+		if (text.size() < prefix.size())
+			return false;
+		for (size_t i = 0; i < prefix.size(); ++i)
+		{
+			if (std::tolower((unsigned char)text[i]) != std::tolower((unsigned char)prefix[i]))
+				return false;
+		}
+		return true;
+	}
+
+	// Value of the header field 'name' ("Content-Length"), or an empty view if the header has no such field.
+	// header: The header lines, up to the empty line.
+	inline std::string_view FindHeaderField(std::string_view header, std::string_view name)
+	{
+		while (!header.empty())
+		{
+			const size_t lineEnd = std::min(header.find("\r\n"), header.size());
+			const std::string_view line = header.substr(0, lineEnd);
+			if (StartsWithIgnoreCase(line, name) && line.size() > name.size() && line[name.size()] == ':')
+			{
+				std::string_view value = line.substr(name.size() + 1);
+				while (!value.empty() && value.front() == ' ')
+					value.remove_prefix(1);
+				return value;
+			}
+			header.remove_prefix(std::min(lineEnd + 2, header.size()));
+		}
+		return std::string_view();
+	}
+
+	// Returns the end of the frame starting at 'start', or npos if it has not been read completely yet.
+	// outBodyStart: Set to where the body starts, right after the empty line.
+	// A header without a Content-Length ends the frame right after the header, the connection reports the error.
+	inline size_t FindEnd(std::string_view input, size_t start, size_t& outBodyStart)
+	{
+		const size_t headerEnd = input.find("\r\n\r\n", start);
+		if (headerEnd == std::string_view::npos)
+			return std::string_view::npos;
+		outBodyStart = headerEnd + 4;
+
+		const std::string contentLength(FindHeaderField(input.substr(start, headerEnd - start), "Content-Length"));
+		const size_t bodyCount = (size_t)std::strtoull(contentLength.c_str(), nullptr, 10);
+		return input.size() - outBodyStart >= bodyCount ? outBodyStart + bodyCount : std::string_view::npos;
+	}
+
+	inline size_t FindEnd(std::string_view input, size_t start)
+	{
+		size_t bodyStart;
+		return FindEnd(input, start, bodyStart);
+	}
+}
@@ -0,0 +1,807 @@
+// Generated by language/tree-sitter-hlslv/GenerateNodeKinds.js from node-types.json, do not edit. Run UpdateLanguage.bat after changing grammar.js.
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Every named node of the grammar, and the keywords, to switch on instead of comparing ts_node_type() strings.
+// The kind of a node is looked up from its TSSymbol in NodeKindTable.
+enum class NodeKind : uint16_t
+{
+	Unknown,	// Not in the grammar the header was generated from, and punctuation.
+	AbstractArrayDeclarator,
+	AbstractFunctionDeclarator,
+	AbstractParenthesizedDeclarator,
+	AbstractPointerDeclarator,
+	AbstractReferenceDeclarator,
+	AccessSpecifier,
+	AliasDeclaration,
+	AlignasQualifier,
+	AlignofExpression,
+	ArgumentList,
+	ArrayDeclarator,
+	AssignmentExpression,
+	Attribute,
+	AttributeDeclaration,
+	AttributeSpecifier,
+	AttributedDeclarator,
+	AttributedStatement,
+	Auto,
+	BaseClassClause,
+	BinaryExpression,
+	BitfieldClause,
+	BreakStatement,
+	CallExpression,
+	CaseStatement,
+	CastExpression,
+	CatchClause,
+	CbufferSpecifier,
+	CharLiteral,
+	Character,
+	ClassSpecifier,
+	CoAwaitExpression,
+	CoReturnStatement,
+	CoYieldStatement,
+	CommaExpression,
+	Comment,
+	CompoundLiteralExpression,
+	CompoundRequirement,
+	CompoundStatement,
+	ConcatenatedString,
+	ConceptDefinition,
+	ConditionClause,
+	ConditionalExpression,
+	ConstraintConjunction,
+	ConstraintDisjunction,
+	ContinueStatement,
+	Declaration,
+	DeclarationList,
+	Decltype,
+	DefaultMethodClause,
+	DeleteExpression,
+	DeleteMethodClause,
+	DependentName,
+	DependentType,
+	DestructorName,
+	DiscardStatement,
+	DoStatement,
+	ElseClause,
+	EnumSpecifier,
+	Enumerator,
+	EnumeratorList,
+	EscapeSequence,
+	ExplicitFunctionSpecifier,
+	ExportDeclaration,
+	Expression,
+	ExpressionStatement,
+	ExtensionExpression,
+	False,
+	FieldDeclaration,
+	FieldDeclarationList,
+	FieldDesignator,
+	FieldExpression,
+	FieldIdentifier,
+	FieldInitializer,
+	FieldInitializerList,
+	FoldExpression,
+	ForRangeLoop,
+	ForStatement,
+	FriendDeclaration,
+	FunctionDeclarator,
+	FunctionDefinition,
+	GenericExpression,
+	GlobalModuleFragmentDeclaration,
+	GnuAsmClobberList,
+	GnuAsmExpression,
+	GnuAsmGotoList,
+	GnuAsmInputOperand,
+	GnuAsmInputOperandList,
+	GnuAsmOutputOperand,
+	GnuAsmOutputOperandList,
+	GnuAsmQualifier,
+	GotoStatement,
+	HlslAttribute,
+	Identifier,
+	IfStatement,
+	ImportDeclaration,
+	InitDeclarator,
+	InitStatement,
+	InitializerList,
+	InitializerPair,
+	LabeledStatement,
+	LambdaCaptureInitializer,
+	LambdaCaptureSpecifier,
+	LambdaDeclarator,
+	LambdaDefaultCapture,
+	LambdaExpression,
+	LinkageSpecification,
+	LiteralSuffix,
+	ModuleDeclaration,
+	ModuleName,
+	ModulePartition,
+	MsBasedModifier,
+	MsCallModifier,
+	MsDeclspecModifier,
+	MsPointerModifier,
+	MsRestrictModifier,
+	MsSignedPtrModifier,
+	MsUnalignedPtrModifier,
+	MsUnsignedPtrModifier,
+	NamespaceAliasDefinition,
+	NamespaceDefinition,
+	NamespaceIdentifier,
+	NestedNamespaceSpecifier,
+	NewDeclarator,
+	NewExpression,
+	Noexcept,
+	Null,
+	NumberLiteral,
+	OffsetofExpression,
+	OperatorCast,
+	OperatorName,
+	OptionalParameterDeclaration,
+	OptionalTypeParameterDeclaration,
+	ParameterDeclaration,
+	ParameterList,
+	ParameterPackExpansion,
+	ParenthesizedDeclarator,
+	ParenthesizedExpression,
+	PlaceholderTypeSpecifier,
+	PointerDeclarator,
+	PointerExpression,
+	PointerTypeDeclarator,
+	PreprocArg,
+	PreprocCall,
+	PreprocDef,
+	PreprocDefined,
+	PreprocDirective,
+	PreprocElif,
+	PreprocElifdef,
+	PreprocElse,
+	PreprocFunctionDef,
+	PreprocIf,
+	PreprocIfdef,
+	PreprocInclude,
+	PreprocParams,
+	PrimitiveType,
+	PrivateModuleFragmentDeclaration,
+	PureVirtualClause,
+	QualifiedIdentifier,
+	Qualifiers,
+	RawStringContent,
+	RawStringDelimiter,
+	RawStringLiteral,
+	RefQualifier,
+	ReferenceDeclarator,
+	RequirementSeq,
+	RequiresClause,
+	RequiresExpression,
+	ReturnStatement,
+	SehExceptClause,
+	SehFinallyClause,
+	SehLeaveStatement,
+	SehTryStatement,
+	Semantics,
+	SimpleRequirement,
+	SizedTypeSpecifier,
+	SizeofExpression,
+	Statement,
+	StatementIdentifier,
+	StaticAssertDeclaration,
+	StorageClassSpecifier,
+	StringContent,
+	StringLiteral,
+	StructSpecifier,
+	StructuredBindingDeclarator,
+	SubscriptArgumentList,
+	SubscriptDesignator,
+	SubscriptExpression,
+	SubscriptRangeDesignator,
+	SwitchStatement,
+	SystemLibString,
+	TemplateArgumentList,
+	TemplateDeclaration,
+	TemplateFunction,
+	TemplateInstantiation,
+	TemplateMethod,
+	TemplateParameterList,
+	TemplateTemplateParameterDeclaration,
+	TemplateType,
+	This,
+	ThrowSpecifier,
+	ThrowStatement,
+	TrailingReturnType,
+	TranslationUnit,
+	True,
+	TryStatement,
+	TypeDefinition,
+	TypeDescriptor,
+	TypeIdentifier,
+	TypeParameterDeclaration,
+	TypeQualifier,
+	TypeRequirement,
+	TypeSpecifier,
+	UnaryExpression,
+	UnionSpecifier,
+	UpdateExpression,
+	UserDefinedLiteral,
+	UsingDeclaration,
+	VariadicDeclarator,
+	VariadicParameterDeclaration,
+	VariadicTypeParameterDeclaration,
+	VirtualSpecifier,
+	WhileStatement,
+	KeywordAlignas,
+	KeywordAlignof,
+	KeywordAnd,
+	KeywordAndEq,
+	KeywordAsm,
+	KeywordBitand,
+	KeywordBitor,
+	KeywordBreak,
+	KeywordCase,
+	KeywordCatch,
+	KeywordCbuffer,
+	KeywordCentroid,
+	KeywordClass,
+	KeywordCoAwait,
+	KeywordCoReturn,
+	KeywordCoYield,
+	KeywordColumnMajor,
+	KeywordCompl,
+	KeywordConcept,
+	KeywordConst,
+	KeywordConsteval,
+	KeywordConstexpr,
+	KeywordConstinit,
+	KeywordContinue,
+	KeywordDecltype,
+	KeywordDefault,
+	KeywordDefined,
+	KeywordDelete,
+	KeywordDiscard,
+	KeywordDo,
+	KeywordElse,
+	KeywordEnum,
+	KeywordExplicit,
+	KeywordExport,
+	KeywordExtern,
+	KeywordFinal,
+	KeywordFor,
+	KeywordFriend,
+	KeywordGloballycoherent,
+	KeywordGoto,
+	KeywordGroupshared,
+	KeywordIf,
+	KeywordImport,
+	KeywordIn,
+	KeywordInline,
+	KeywordInout,
+	KeywordLine,
+	KeywordLineadj,
+	KeywordLinear,
+	KeywordLong,
+	KeywordModule,
+	KeywordMutable,
+	KeywordNamespace,
+	KeywordNew,
+	KeywordNoexcept,
+	KeywordNointerpolation,
+	KeywordNoperspective,
+	KeywordNoreturn,
+	KeywordNot,
+	KeywordNotEq,
+	KeywordNullptr,
+	KeywordOffsetof,
+	KeywordOperator,
+	KeywordOr,
+	KeywordOrEq,
+	KeywordOut,
+	KeywordOverride,
+	KeywordPoint,
+	KeywordPrecise,
+	KeywordPrivate,
+	KeywordProtected,
+	KeywordPublic,
+	KeywordRegister,
+	KeywordRequires,
+	KeywordRestrict,
+	KeywordReturn,
+	KeywordRowMajor,
+	KeywordSample,
+	KeywordShared,
+	KeywordShort,
+	KeywordSigned,
+	KeywordSizeof,
+	KeywordSnorm,
+	KeywordStatic,
+	KeywordStaticAssert,
+	KeywordStruct,
+	KeywordSwitch,
+	KeywordTemplate,
+	KeywordThreadLocal,
+	KeywordThrow,
+	KeywordTriangle,
+	KeywordTriangleadj,
+	KeywordTry,
+	KeywordTypedef,
+	KeywordTypename,
+	KeywordUniform,
+	KeywordUnion,
+	KeywordUnorm,
+	KeywordUnsigned,
+	KeywordUsing,
+	KeywordVirtual,
+	KeywordVolatile,
+	KeywordWhile,
+	KeywordXor,
+	KeywordXorEq,
+	Count,
+};
+
+// Every field of the grammar, looked up from its TSFieldId in NodeKindTable.
+enum class FieldKind : uint16_t
+{
+	Unknown,
+	Alternative,
+	Argument,
+	Arguments,
+	AssemblyCode,
+	Base,
+	Body,
+	Captures,
+	Clobbers,
+	Condition,
+	Consequence,
+	Constraint,
+	Declarator,
+	DefaultType,
+	DefaultValue,
+	Delimiter,
+	Designator,
+	Directive,
+	End,
+	Field,
+	Filter,
+	Function,
+	GotoLabels,
+	Header,
+	Indices,
+	Initializer,
+	InputOperands,
+	Label,
+	Left,
+	Length,
+	Member,
+	Message,
+	Name,
+	Namespace,
+	Operand,
+	Operator,
+	OutputOperands,
+	Parameters,
+	Partition,
+	Path,
+	Pattern,
+	Placement,
+	Prefix,
+	Register,
+	Requirements,
+	Right,
+	Scope,
+	Size,
+	Start,
+	Symbol,
+	TemplateParameters,
+	Type,
+	Update,
+	Value,
+	Count,
+};
+
+namespace NodeKinds
+{
+	struct KindName
+	{
+		std::string_view name;
+		bool named;
+	};
+
+	// Indexed by NodeKind.
+	inline constexpr KindName s_KindNames[] =
+	{
+		{ "", false },
+		{ "abstract_array_declarator", true },
+		{ "abstract_function_declarator", true },
+		{ "abstract_parenthesized_declarator", true },
+		{ "abstract_pointer_declarator", true },
+		{ "abstract_reference_declarator", true },
+		{ "access_specifier", true },
+		{ "alias_declaration", true },
+		{ "alignas_qualifier", true },
+		{ "alignof_expression", true },
+		{ "argument_list", true },
+		{ "array_declarator", true },
+		{ "assignment_expression", true },
+		{ "attribute", true },
+		{ "attribute_declaration", true },
+		{ "attribute_specifier", true },
+		{ "attributed_declarator", true },
+		{ "attributed_statement", true },
+		{ "auto", true },
+		{ "base_class_clause", true },
+		{ "binary_expression", true },
+		{ "bitfield_clause", true },
+		{ "break_statement", true },
+		{ "call_expression", true },
+		{ "case_statement", true },
+		{ "cast_expression", true },
+		{ "catch_clause", true },
+		{ "cbuffer_specifier", true },
+		{ "char_literal", true },
+		{ "character", true },
+		{ "class_specifier", true },
+		{ "co_await_expression", true },
+		{ "co_return_statement", true },
+		{ "co_yield_statement", true },
+		{ "comma_expression", true },
+		{ "comment", true },
+		{ "compound_literal_expression", true },
+		{ "compound_requirement", true },
+		{ "compound_statement", true },
+		{ "concatenated_string", true },
+		{ "concept_definition", true },
+		{ "condition_clause", true },
+		{ "conditional_expression", true },
+		{ "constraint_conjunction", true },
+		{ "constraint_disjunction", true },
+		{ "continue_statement", true },
+		{ "declaration", true },
+		{ "declaration_list", true },
+		{ "decltype", true },
+		{ "default_method_clause", true },
+		{ "delete_expression", true },
+		{ "delete_method_clause", true },
+		{ "dependent_name", true },
+		{ "dependent_type", true },
+		{ "destructor_name", true },
+		{ "discard_statement", true },
+		{ "do_statement", true },
+		{ "else_clause", true },
+		{ "enum_specifier", true },
+		{ "enumerator", true },
+		{ "enumerator_list", true },
+		{ "escape_sequence", true },
+		{ "explicit_function_specifier", true },
+		{ "export_declaration", true },
+		{ "expression", true },
+		{ "expression_statement", true },
+		{ "extension_expression", true },
+		{ "false", true },
+		{ "field_declaration", true },
+		{ "field_declaration_list", true },
+		{ "field_designator", true },
+		{ "field_expression", true },
+		{ "field_identifier", true },
+		{ "field_initializer", true },
+		{ "field_initializer_list", true },
+		{ "fold_expression", true },
+		{ "for_range_loop", true },
+		{ "for_statement", true },
+		{ "friend_declaration", true },
+		{ "function_declarator", true },
+		{ "function_definition", true },
+		{ "generic_expression", true },
+		{ "global_module_fragment_declaration", true },
+		{ "gnu_asm_clobber_list", true },
+		{ "gnu_asm_expression", true },
+		{ "gnu_asm_goto_list", true },
+		{ "gnu_asm_input_operand", true },
+		{ "gnu_asm_input_operand_list", true },
+		{ "gnu_asm_output_operand", true },
+		{ "gnu_asm_output_operand_list", true },
+		{ "gnu_asm_qualifier", true },
+		{ "goto_statement", true },
+		{ "hlsl_attribute", true },
+		{ "identifier", true },
+		{ "if_statement", true },
+		{ "import_declaration", true },
+		{ "init_declarator", true },
+		{ "init_statement", true },
+		{ "initializer_list", true },
+		{ "initializer_pair", true },
+		{ "labeled_statement", true },
+		{ "lambda_capture_initializer", true },
+		{ "lambda_capture_specifier", true },
+		{ "lambda_declarator", true },
+		{ "lambda_default_capture", true },
+		{ "lambda_expression", true },
+		{ "linkage_specification", true },
+		{ "literal_suffix", true },
+		{ "module_declaration", true },
+		{ "module_name", true },
+		{ "module_partition", true },
+		{ "ms_based_modifier", true },
+		{ "ms_call_modifier", true },
+		{ "ms_declspec_modifier", true },
+		{ "ms_pointer_modifier", true },
+		{ "ms_restrict_modifier", true },
+		{ "ms_signed_ptr_modifier", true },
+		{ "ms_unaligned_ptr_modifier", true },
+		{ "ms_unsigned_ptr_modifier", true },
+		{ "namespace_alias_definition", true },
+		{ "namespace_definition", true },
+		{ "namespace_identifier", true },
+		{ "nested_namespace_specifier", true },
+		{ "new_declarator", true },
+		{ "new_expression", true },
+		{ "noexcept", true },
+		{ "null", true },
+		{ "number_literal", true },
+		{ "offsetof_expression", true },
+		{ "operator_cast", true },
+		{ "operator_name", true },
+		{ "optional_parameter_declaration", true },
+		{ "optional_type_parameter_declaration", true },
+		{ "parameter_declaration", true },
+		{ "parameter_list", true },
+		{ "parameter_pack_expansion", true },
+		{ "parenthesized_declarator", true },
+		{ "parenthesized_expression", true },
+		{ "placeholder_type_specifier", true },
+		{ "pointer_declarator", true },
+		{ "pointer_expression", true },
+		{ "pointer_type_declarator", true },
+		{ "preproc_arg", true },
+		{ "preproc_call", true },
+		{ "preproc_def", true },
+		{ "preproc_defined", true },
+		{ "preproc_directive", true },
+		{ "preproc_elif", true },
+		{ "preproc_elifdef", true },
+		{ "preproc_else", true },
+		{ "preproc_function_def", true },
+		{ "preproc_if", true },
+		{ "preproc_ifdef", true },
+		{ "preproc_include", true },
+		{ "preproc_params", true },
+		{ "primitive_type", true },
+		{ "private_module_fragment_declaration", true },
+		{ "pure_virtual_clause", true },
+		{ "qualified_identifier", true },
+		{ "qualifiers", true },
+		{ "raw_string_content", true },
+		{ "raw_string_delimiter", true },
+		{ "raw_string_literal", true },
+		{ "ref_qualifier", true },
+		{ "reference_declarator", true },
+		{ "requirement_seq", true },
+		{ "requires_clause", true },
+		{ "requires_expression", true },
+		{ "return_statement", true },
+		{ "seh_except_clause", true },
+		{ "seh_finally_clause", true },
+		{ "seh_leave_statement", true },
+		{ "seh_try_statement", true },
+		{ "semantics", true },
+		{ "simple_requirement", true },
+		{ "sized_type_specifier", true },
+		{ "sizeof_expression", true },
+		{ "statement", true },
+		{ "statement_identifier", true },
+		{ "static_assert_declaration", true },
+		{ "storage_class_specifier", true },
+		{ "string_content", true },
+		{ "string_literal", true },
+		{ "struct_specifier", true },
+		{ "structured_binding_declarator", true },
+		{ "subscript_argument_list", true },
+		{ "subscript_designator", true },
+		{ "subscript_expression", true },
+		{ "subscript_range_designator", true },
+		{ "switch_statement", true },
+		{ "system_lib_string", true },
+		{ "template_argument_list", true },
+		{ "template_declaration", true },
+		{ "template_function", true },
+		{ "template_instantiation", true },
+		{ "template_method", true },
+		{ "template_parameter_list", true },
+		{ "template_template_parameter_declaration", true },
+		{ "template_type", true },
+		{ "this", true },
+		{ "throw_specifier", true },
+		{ "throw_statement", true },
+		{ "trailing_return_type", true },
+		{ "translation_unit", true },
+		{ "true", true },
+		{ "try_statement", true },
+		{ "type_definition", true },
+		{ "type_descriptor", true },
+		{ "type_identifier", true },
+		{ "type_parameter_declaration", true },
+		{ "type_qualifier", true },
+		{ "type_requirement", true },
+		{ "type_specifier", true },
+		{ "unary_expression", true },
+		{ "union_specifier", true },
+		{ "update_expression", true },
+		{ "user_defined_literal", true },
+		{ "using_declaration", true },
+		{ "variadic_declarator", true },
+		{ "variadic_parameter_declaration", true },
+		{ "variadic_type_parameter_declaration", true },
+		{ "virtual_specifier", true },
+		{ "while_statement", true },
+		{ "alignas", false },
+		{ "alignof", false },
+		{ "and", false },
+		{ "and_eq", false },
+		{ "asm", false },
+		{ "bitand", false },
+		{ "bitor", false },
+		{ "break", false },
+		{ "case", false },
+		{ "catch", false },
+		{ "cbuffer", false },
+		{ "centroid", false },
+		{ "class", false },
+		{ "co_await", false },
+		{ "co_return", false },
+		{ "co_yield", false },
+		{ "column_major", false },
+		{ "compl", false },
+		{ "concept", false },
+		{ "const", false },
+		{ "consteval", false },
+		{ "constexpr", false },
+		{ "constinit", false },
+		{ "continue", false },
+		{ "decltype", false },
+		{ "default", false },
+		{ "defined", false },
+		{ "delete", false },
+		{ "discard", false },
+		{ "do", false },
+		{ "else", false },
+		{ "enum", false },
+		{ "explicit", false },
+		{ "export", false },
+		{ "extern", false },
+		{ "final", false },
+		{ "for", false },
+		{ "friend", false },
+		{ "globallycoherent", false },
+		{ "goto", false },
+		{ "groupshared", false },
+		{ "if", false },
+		{ "import", false },
+		{ "in", false },
+		{ "inline", false },
+		{ "inout", false },
+		{ "line", false },
+		{ "lineadj", false },
+		{ "linear", false },
+		{ "long", false },
+		{ "module", false },
+		{ "mutable", false },
+		{ "namespace", false },
+		{ "new", false },
+		{ "noexcept", false },
+		{ "nointerpolation", false },
+		{ "noperspective", false },
+		{ "noreturn", false },
+		{ "not", false },
+		{ "not_eq", false },
+		{ "nullptr", false },
+		{ "offsetof", false },
+		{ "operator", false },
+		{ "or", false },
+		{ "or_eq", false },
+		{ "out", false },
+		{ "override", false },
+		{ "point", false },
+		{ "precise", false },
+		{ "private", false },
+		{ "protected", false },
+		{ "public", false },
+		{ "register", false },
+		{ "requires", false },
+		{ "restrict", false },
+		{ "return", false },
+		{ "row_major", false },
+		{ "sample", false },
+		{ "shared", false },
+		{ "short", false },
+		{ "signed", false },
+		{ "sizeof", false },
+		{ "snorm", false },
+		{ "static", false },
+		{ "static_assert", false },
+		{ "struct", false },
+		{ "switch", false },
+		{ "template", false },
+		{ "thread_local", false },
+		{ "throw", false },
+		{ "triangle", false },
+		{ "triangleadj", false },
+		{ "try", false },
+		{ "typedef", false },
+		{ "typename", false },
+		{ "uniform", false },
+		{ "union", false },
+		{ "unorm", false },
+		{ "unsigned", false },
+		{ "using", false },
+		{ "virtual", false },
+		{ "volatile", false },
+		{ "while", false },
+		{ "xor", false },
+		{ "xor_eq", false },
+	};
+
+	// Indexed by FieldKind.
+	inline constexpr std::string_view s_FieldNames[] =
+	{
+		"",
+		"alternative",
+		"argument",
+		"arguments",
+		"assembly_code",
+		"base",
+		"body",
+		"captures",
+		"clobbers",
+		"condition",
+		"consequence",
+		"constraint",
+		"declarator",
+		"default_type",
+		"default_value",
+		"delimiter",
+		"designator",
+		"directive",
+		"end",
+		"field",
+		"filter",
+		"function",
+		"goto_labels",
+		"header",
+		"indices",
+		"initializer",
+		"input_operands",
+		"label",
+		"left",
+		"length",
+		"member",
+		"message",
+		"name",
+		"namespace",
+		"operand",
+		"operator",
+		"output_operands",
+		"parameters",
+		"partition",
+		"path",
+		"pattern",
+		"placement",
+		"prefix",
+		"register",
+		"requirements",
+		"right",
+		"scope",
+		"size",
+		"start",
+		"symbol",
+		"template_parameters",
+		"type",
+		"update",
+		"value",
+	};
+
+	static_assert(sizeof(s_KindNames) / sizeof(s_KindNames[0]) == (size_t)NodeKind::Count);
+	static_assert(sizeof(s_FieldNames) / sizeof(s_FieldNames[0]) == (size_t)FieldKind::Count);
+
+	constexpr std::string_view GetName(NodeKind kind) { return s_KindNames[(size_t)kind].name; }
+	constexpr std::string_view GetName(FieldKind field) { return s_FieldNames[(size_t)field]; }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+#include "tree_sitter_hlslv/tree-sitter-hlslvparser.h"
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "NodeKind.h"
+
+// Maps the TSSymbol and TSFieldId numbers of the parser to NodeKind and FieldKind, so nodes are told apart with a switch instead of
+// comparing ts_node_type() strings. The numbers are made up by tree-sitter generate, so they are looked up by name once when the server starts.
+// A symbol the generated NodeKind.h does not know of maps to NodeKind::Unknown.
+struct NodeKindTable
+{
+public:
+	explicit NodeKindTable(const TSLanguage* pLanguage)
+	{
+		std::unordered_map<std::string_view, NodeKind> namedKinds;
+		std::unordered_map<std::string_view, NodeKind> anonymousKinds;
+		for (size_t i = 1; i < (size_t)NodeKind::Count; ++i)
+		{
+			const NodeKinds::KindName& kindName = NodeKinds::s_KindNames[i];
+			(kindName.named ? namedKinds : anonymousKinds).emplace(kindName.name, (NodeKind)i);
+		}
+
+		// Aliased nodes have symbols of their own, with the name of the alias.
+		m_Kinds.resize(ts_language_symbol_count(pLanguage), NodeKind::Unknown);
+		for (TSSymbol symbol = 0; symbol < m_Kinds.size(); ++symbol)
+		{
+			const char* pName = ts_language_symbol_name(pLanguage, symbol);
+			if (!pName)
+				continue;
+			const TSSymbolType type = ts_language_symbol_type(pLanguage, symbol);
+			if (type == TSSymbolTypeAuxiliary)
+				continue;
+			const auto& kinds = type == TSSymbolTypeAnonymous ? anonymousKinds : namedKinds;
+			if (auto it = kinds.find(pName); it != kinds.end())
+				m_Kinds[symbol] = it->second;
+		}
+
+		// Field ids start at 1, 0 is no field.
+		m_Fields.resize(ts_language_field_count(pLanguage) + 1, FieldKind::Unknown);
+		for (size_t i = 1; i < (size_t)FieldKind::Count; ++i)
+		{
+			const std::string_view name = NodeKinds::s_FieldNames[i];
+			const TSFieldId id = ts_language_field_id_for_name(pLanguage, name.data(), (uint32_t)name.size());
+			m_FieldIds[i] = id;
+			if (id != 0 && id < m_Fields.size())
+				m_Fields[id] = (FieldKind)i;
+		}
+	}
+
+	// The table of the HLSLV parser.
+	static const NodeKindTable& Get()
+	{
+		static const NodeKindTable s_Table(tree_sitter_hlslvparser());
+		return s_Table;
+	}
+
+	NodeKind GetKind(TSSymbol symbol) const { return symbol < m_Kinds.size() ? m_Kinds[symbol] : NodeKind::Unknown; }
+	NodeKind GetKind(TSNode node) const { return GetKind(ts_node_symbol(node)); }
+
+	FieldKind GetField(TSFieldId id) const { return id < m_Fields.size() ? m_Fields[id] : FieldKind::Unknown; }
+	FieldKind GetField(const TSTreeCursor& cursor) const { return GetField(ts_tree_cursor_current_field_id(&cursor)); }
+
+	// 0 if the parser has no such field.
+	TSFieldId GetFieldId(FieldKind field) const { return m_FieldIds[(size_t)field]; }
+
+private:
+	std::vector<NodeKind> m_Kinds;		// Indexed by TSSymbol.
+	std::vector<FieldKind> m_Fields;	// Indexed by TSFieldId.
+	TSFieldId m_FieldIds[(size_t)FieldKind::Count] = {};
+};
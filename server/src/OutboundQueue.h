@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+
+// Lock-free queue of encoded messages, pushed by any thread and drained by one writer thread.
+// Pushing links the message in front of a singly linked list (a Treiber stack) with one compare-exchange,
+// the writer takes the whole list at once and reverses it back into the order the messages were pushed in:
+//
+// Push C:  head -> C -> B -> A
+// TakeAll: head -> null,  returns A -> B -> C
+struct OutboundQueue
+{
+public:
+	struct Message
+	{
+		std::string data;
+		Message* pNext = nullptr;
+	};
+
+	OutboundQueue() {}
+	~OutboundQueue() { Delete(m_pHead.exchange(nullptr)); }
+
+	OutboundQueue(const OutboundQueue&) = delete;
+	OutboundQueue& operator=(const OutboundQueue&) = delete;
+
+	// Can be called from any thread.
+	void Push(std::string data)
+	{
+		Message* pMessage = new Message{ std::move(data), m_pHead.load(std::memory_order_relaxed) };
+		while (!m_pHead.compare_exchange_weak(pMessage->pNext, pMessage, std::memory_order_release, std::memory_order_relaxed))
+			;
+		m_pHead.notify_one();
+	}
+
+	// Blocks until there is at least one message and returns all of them, oldest first. Free them with Delete.
+	// Note: Only one thread may take messages.
+	Message* TakeAll()
+	{
+		m_pHead.wait(nullptr, std::memory_order_acquire);
+		Message* pMessage = m_pHead.exchange(nullptr, std::memory_order_acquire);
+
+		Message* pReversed = nullptr;
+		while (pMessage)
+		{
+			Message* pNext = pMessage->pNext;
+			pMessage->pNext = pReversed;
+			pReversed = pMessage;
+			pMessage = pNext;
+		}
+		return pReversed;
+	}
+
+	static void Delete(Message* pMessage)
+	{
+		while (pMessage)
+		{
+			Message* pNext = pMessage->pNext;
+			delete pMessage;
+			pMessage = pNext;
+		}
+	}
+
+private:
+	std::atomic<Message*> m_pHead = nullptr;
+};
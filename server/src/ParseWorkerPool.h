@@ -0,0 +1,291 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <format>
+
+#include "DocumentSnapshot.h"
+#include "TextStorageInput.h"
+#include "CancellationToken.h"
+#include "Trace.h"
+#include "LatencyHistogram.h"
+
+// A tree parsed on a worker, to be handed to the document it was parsed from.
+struct ParseResult
+{
+	DocumentSnapshotPtr pSnapshot;	// The version that was parsed.
+	TSTree* pTree = nullptr;		// Owned by whoever takes the result. nullptr if the parse ran out of time.
+};
+
+// Parses documents on background threads so the message loop stays responsive.
+// Each worker owns its own TSParser, since a parser cannot be used by more than one thread at a time.
+// Documents are assigned to a worker by URI, which keeps the parses of one document in order:
+//
+// Dispatch(a.hlsl v3) --> [ worker 0 ]: a.hlsl v3, c.hlsl v1
+// Dispatch(b.hlsl v7) --> [ worker 1 ]: b.hlsl v7
+//
+// A job that is still queued when a newer version of its document is dispatched is replaced by it. A parse that is already running
+// is left to finish, so a document that takes longer to parse than the user takes to type still gets a tree to reparse from.
+// Only the parses of closed documents are cancelled, through the tree-sitter cancellation flag.
+// Results are collected with PollResults() on the thread that owns the documents.
+struct ParseWorkerPool
+{
+public:
+	// threadCount: 0 picks one from the number of cores.
+	// timeoutMicros: Parses that take longer are given up, the document keeps its previous tree. 0 for no limit.
+	// onResult: Called on the worker thread each time a result is ready, to wake up the thread that polls them.
+	ParseWorkerPool(const TSLanguage* pLanguage, size_t threadCount = 0, uint64_t timeoutMicros = 0, std::function<void()> onResult = nullptr)
+		: m_TimeoutMicros(timeoutMicros), m_OnResult(std::move(onResult))
+	{
+		if (threadCount == 0)
+		{
+			const size_t cores = std::thread::hardware_concurrency();
+			threadCount = cores > 2 ? std::min<size_t>(cores - 1, m_sMaxDefaultThreadCount) : 1;
+		}
+
+		m_Workers.reserve(threadCount);
+		for (size_t i = 0; i < threadCount; ++i)
+			m_Workers.push_back(std::make_unique<Worker>());
+		for (std::unique_ptr<Worker>& pWorker : m_Workers)
+			pWorker->thread = std::thread(&ParseWorkerPool::Run, this, pWorker.get(), pLanguage);
+	}
+
+	~ParseWorkerPool()
+	{
+		for (std::unique_ptr<Worker>& pWorker : m_Workers)
+		{
+			{
+				std::lock_guard<std::mutex> lock(pWorker->mutex);
+				pWorker->stop = true;
+			}
+			pWorker->condition.notify_one();
+		}
+
+		for (std::unique_ptr<Worker>& pWorker : m_Workers)
+		{
+			pWorker->thread.join();
+			for (Job& job : pWorker->jobs)
+				DeleteTree(job.pOldTree);
+		}
+
+		for (ParseResult& result : m_Results)
+			DeleteTree(result.pTree);
+	}
+
+	ParseWorkerPool(const ParseWorkerPool&) = delete;
+	ParseWorkerPool& operator=(const ParseWorkerPool&) = delete;
+
+	// What the workers have done so far, can be read from any thread.
+	struct Stats
+	{
+		std::atomic<uint64_t> parseCount = 0;		// From scratch.
+		std::atomic<uint64_t> parsedBytes = 0;
+		std::atomic<uint64_t> reparseCount = 0;		// Reusing the previous tree.
+		std::atomic<uint64_t> reparsedBytes = 0;	// Size of the documents that were reparsed.
+		std::atomic<uint64_t> replacedCount = 0;	// Replaced by a newer version before they started.
+		std::atomic<uint64_t> cancelledCount = 0;	// Stopped while running, because the document was closed.
+		std::atomic<uint64_t> timedOutCount = 0;
+		LatencyHistogram parseTime;
+		LatencyHistogram reparseTime;
+
+		std::string ToJson() const
+		{
+			return std::format(R"({{"parses":{},"parsedBytes":{},"reparses":{},"reparsedBytes":{},"replaced":{},"cancelled":{},"timedOut":{},"parseTime":{},"reparseTime":{}}})",
+				parseCount.load(), parsedBytes.load(), reparseCount.load(), reparsedBytes.load(), replacedCount.load(), cancelledCount.load(), timedOutCount.load(),
+				parseTime.ToJson(), reparseTime.ToJson());
+		}
+	};
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	// Queues a parse of the snapshot.
+	// pOldTree: The previous tree of the document with all edits since applied (ts_tree_edit), or nullptr to parse from scratch.
+	//           The pool takes ownership of it, pass a ts_tree_copy of the tree the document keeps.
+	void Dispatch(DocumentSnapshotPtr pSnapshot, TSTree* pOldTree)
+	{
+		Worker& worker = GetWorker(pSnapshot->GetUri());
+		{
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			for (Job& job : worker.jobs)
+			{
+				if (job.pSnapshot->GetUri() == pSnapshot->GetUri())
+				{
+					// Not started yet, the newer version is parsed in its place.
+					m_Stats.replacedCount.fetch_add(1, std::memory_order_relaxed);
+					DeleteTree(job.pOldTree);
+					job.pSnapshot = std::move(pSnapshot);
+					job.pOldTree = pOldTree;
+					return;
+				}
+			}
+			worker.jobs.push_back(Job{ std::move(pSnapshot), pOldTree });
+		}
+		worker.condition.notify_one();
+	}
+
+	// Drops the queued parse of the document and cancels a running one, for documents that were closed.
+	void Cancel(const std::string& uri)
+	{
+		Worker& worker = GetWorker(uri);
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if (worker.currentUri == uri)
+			worker.currentToken.Cancel();
+
+		for (auto it = worker.jobs.begin(); it != worker.jobs.end(); ++it)
+		{
+			if (it->pSnapshot->GetUri() == uri)
+			{
+				DeleteTree(it->pOldTree);
+				worker.jobs.erase(it);
+				break;
+			}
+		}
+	}
+
+	// Calls the callback with every finished parse and clears them. The callback takes ownership of the tree.
+	// Note: Results can be older than the document by now, the caller has to compare the snapshot against the document.
+	void PollResults(const std::function<void(ParseResult&&)>& callback)
+	{
+		std::vector<ParseResult> results;
+		{
+			std::lock_guard<std::mutex> lock(m_ResultMutex);
+			results.swap(m_Results);
+		}
+
+		for (ParseResult& result : results)
+			callback(std::move(result));
+	}
+
+	size_t GetThreadCount() const { return m_Workers.size(); }
+
+private:
+	struct Job
+	{
+		DocumentSnapshotPtr pSnapshot;
+		TSTree* pOldTree = nullptr;
+	};
+
+	struct Worker
+	{
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::deque<Job> jobs;
+		bool stop = false;
+
+		// The parse that is running.
+		std::string currentUri;
+		CancellationToken currentToken;
+	};
+
+	Worker& GetWorker(const std::string& uri) { return *m_Workers[std::hash<std::string>()(uri) % m_Workers.size()]; }
+
+	void Run(Worker* pWorker, const TSLanguage* pLanguage)
+	{
+		MSLP_TRACE_THREAD("Parser");
+		TSParser* pParser = ts_parser_new();
+		ts_parser_set_language(pParser, pLanguage);
+		ts_parser_set_timeout_micros(pParser, m_TimeoutMicros);
+
+		while (true)
+		{
+			Job job;
+			CancellationToken token;
+			{
+				std::unique_lock<std::mutex> lock(pWorker->mutex);
+				pWorker->condition.wait(lock, [pWorker]() { return pWorker->stop || !pWorker->jobs.empty(); });
+				if (pWorker->stop)
+					break;
+				job = std::move(pWorker->jobs.front());
+				pWorker->jobs.pop_front();
+				pWorker->currentUri = job.pSnapshot->GetUri();
+				pWorker->currentToken = token;
+			}
+
+			// The snapshot keeps the text alive and unchanged for the whole parse.
+			TSTree* pTree = nullptr;
+			const bool isReparse = job.pOldTree != nullptr;
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			{
+				MSLP_TRACE_ZONE(job.pOldTree ? "Reparse" : "Parse");
+				TextStorageInput input(job.pSnapshot->GetStorage());
+				ts_parser_set_cancellation_flag(pParser, token.GetFlag());
+				pTree = ts_parser_parse(pParser, job.pOldTree, input.GetInput());
+				ts_parser_set_cancellation_flag(pParser, nullptr);
+				DeleteTree(job.pOldTree);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(pWorker->mutex);
+				pWorker->currentUri.clear();
+			}
+
+			// A parse that was stopped would otherwise be resumed by the next call, which is for another text.
+			if (pTree == nullptr)
+				ts_parser_reset(pParser);
+
+			// Cancelled parses are of a document that was closed.
+			if (token.IsCancelled())
+			{
+				m_Stats.cancelledCount.fetch_add(1, std::memory_order_relaxed);
+				DeleteTree(pTree);
+				continue;
+			}
+			RecordParse(isReparse, job.pSnapshot->GetStorage().GetCount(), std::chrono::steady_clock::now() - start, pTree != nullptr);
+
+			{
+				std::lock_guard<std::mutex> lock(m_ResultMutex);
+				m_Results.push_back(ParseResult{ std::move(job.pSnapshot), pTree });
+			}
+			if (m_OnResult)
+				m_OnResult();
+		}
+
+		ts_parser_delete(pParser);
+	}
+
+	void RecordParse(bool isReparse, size_t byteCount, std::chrono::nanoseconds duration, bool finished)
+	{
+		if (!finished)
+			m_Stats.timedOutCount.fetch_add(1, std::memory_order_relaxed);
+		else if (isReparse)
+		{
+			m_Stats.reparseCount.fetch_add(1, std::memory_order_relaxed);
+			m_Stats.reparsedBytes.fetch_add(byteCount, std::memory_order_relaxed);
+			m_Stats.reparseTime.Record(duration);
+		}
+		else
+		{
+			m_Stats.parseCount.fetch_add(1, std::memory_order_relaxed);
+			m_Stats.parsedBytes.fetch_add(byteCount, std::memory_order_relaxed);
+			m_Stats.parseTime.Record(duration);
+		}
+	}
+
+	static void DeleteTree(TSTree* pTree)
+	{
+		if (pTree)
+			ts_tree_delete(pTree);
+	}
+
+private:
+	inline static constexpr size_t m_sMaxDefaultThreadCount = 4;
+
+	const uint64_t m_TimeoutMicros;
+
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+	std::function<void()> m_OnResult;
+	Stats m_Stats;
+
+	std::mutex m_ResultMutex;
+	std::vector<ParseResult> m_Results;
+};
@@ -0,0 +1,310 @@
+#pragma once
+
+#include <vector>
+#include <cstring> // memcpy
+#include <cassert>
+
+#include "TextStorage.h"
+#include "StorageStats.h"
+
+// Piece table where the pieces are kept in a balanced tree (an implicit treap ordered by text offset).
+// Inserted text is appended to an add-only buffer and referenced by a new piece, nothing already stored is moved.
+// Insert, Erase and offset lookup are O(log pieces).
+//
+// Text:    [ A A A ][ B ][ A A ]
+// Pieces:  (0, 3)  (6, 1)  (3, 2)   <- (start, length) into the data buffer
+// Data:    A A A A A B
+struct PieceTree : public TextStorage
+{
+public:
+	PieceTree(const Type* pInitialData, size_t initialCount)
+	{
+		Init(pInitialData, initialCount);
+	}
+
+	PieceTree& operator=(const PieceTree&) = delete;
+
+	void Insert(size_t index, const Type* pData, size_t dataCount) override
+	{
+#ifdef MSLP_DEBUG
+		assert(index <= GetCount() && "Out of bounds!");
+#endif
+		if (dataCount == 0u)
+			return;
+
+		const uint32_t dataStart = (uint32_t)m_Data.size();
+		MSLP_STORAGE_COPIED(m_Data.capacity() < m_Data.size() + dataCount ? m_Data.size() + dataCount : dataCount);
+		m_Data.insert(m_Data.end(), pData, pData + dataCount);
+
+		uint32_t left, right;
+		Split(m_Root, index, left, right);
+
+		// Typing appends to the end of the data buffer, which the last inserted piece usually already ends at. Extend it instead of adding a piece.
+		const uint32_t last = Rightmost(left);
+		if (last != m_sNull && m_Nodes[last].start + m_Nodes[last].length == dataStart)
+			ExtendRightmost(left, (uint32_t)dataCount);
+		else
+			left = Merge(left, NewNode(dataStart, (uint32_t)dataCount));
+
+		m_Root = Merge(left, right);
+	}
+
+	void Erase(size_t index, size_t count) override
+	{
+#ifdef MSLP_DEBUG
+		assert(index + count <= GetCount() && "Cannot erase more elements than the total amount!");
+#endif
+		if (count == 0u)
+			return;
+
+		uint32_t left, middle, right;
+		Split(m_Root, index, left, right);
+		Split(right, count, middle, right);
+		FreeSubtree(middle);
+		m_Root = Merge(left, right);
+
+		m_DeadCount += count;
+		if (m_DeadCount > m_sCompactMinCount && m_DeadCount > GetCount())
+			Compact();
+	}
+
+	size_t GetCount() const override { return SubtreeLength(m_Root); }
+
+	Type At(size_t index) const override
+	{
+		const Type* pData = nullptr;
+		GetChunk(index, pData);
+#ifdef MSLP_DEBUG
+		assert(pData && "Out of bounds!");
+#endif
+		return *pData;
+	}
+
+	size_t GetChunk(size_t index, const Type*& pOutData) const override
+	{
+		uint32_t node = m_Root;
+		while (node != m_sNull)
+		{
+			const Node& n = m_Nodes[node];
+			const size_t leftLength = SubtreeLength(n.left);
+			if (index < leftLength)
+				node = n.left;
+			else if (index < leftLength + n.length)
+			{
+				const size_t offset = index - leftLength;
+				pOutData = m_Data.data() + n.start + offset;
+				return n.length - offset;
+			}
+			else
+			{
+				index -= leftLength + n.length;
+				node = n.right;
+			}
+		}
+
+		pOutData = nullptr;
+		return 0;
+	}
+
+	void CopyTo(Type* pDest) const override
+	{
+		Type* pWrite = pDest;
+		CopySubtree(m_Root, pWrite);
+	}
+
+	TextStorageKind GetKind() const override { return TextStorageKind::PieceTree; }
+
+	std::unique_ptr<TextStorage> Clone() const override
+	{
+		return std::unique_ptr<TextStorage>(new PieceTree(*this));
+	}
+
+	size_t GetPieceCount() const { return m_Nodes.size() - m_FreeNodes.size(); }
+
+private:
+	PieceTree(const PieceTree&) = default;
+
+	struct Node
+	{
+		uint32_t start = 0;				// Offset into m_Data.
+		uint32_t length = 0;
+		uint32_t subtreeLength = 0;		// Length of this piece and all pieces below it.
+		uint32_t priority = 0;			// Treap priority, a parent always has a higher priority than its children.
+		uint32_t left = m_sNull;
+		uint32_t right = m_sNull;
+	};
+
+	void Init(const Type* pInitialData, size_t initialCount)
+	{
+		m_Nodes.clear();
+		m_FreeNodes.clear();
+		m_Data.assign(pInitialData, pInitialData + initialCount);
+		m_DeadCount = 0;
+		m_Root = initialCount > 0 ? NewNode(0, (uint32_t)initialCount) : m_sNull;
+	}
+
+	// Rewrites the data buffer to only hold the live text, as a single piece.
+	void Compact()
+	{
+		std::vector<Type> text(GetCount());
+		MSLP_STORAGE_COPIED(text.size() * 2);
+		CopyTo(text.data());
+		Init(text.data(), text.size());
+	}
+
+	// Splits the tree such that the first 'offset' elements end up in outLeft and the rest in outRight.
+	// A piece that straddles the offset is cut in two.
+	void Split(uint32_t node, size_t offset, uint32_t& outLeft, uint32_t& outRight)
+	{
+		if (node == m_sNull)
+		{
+			outLeft = outRight = m_sNull;
+			return;
+		}
+
+		const size_t leftLength = SubtreeLength(m_Nodes[node].left);
+		const size_t pieceEnd = leftLength + m_Nodes[node].length;
+		if (offset <= leftLength)
+		{
+			uint32_t newLeft;
+			Split(m_Nodes[node].left, offset, outLeft, newLeft);
+			m_Nodes[node].left = newLeft;
+			Update(node);
+			outRight = node;
+		}
+		else if (offset >= pieceEnd)
+		{
+			uint32_t newRight;
+			Split(m_Nodes[node].right, offset - pieceEnd, newRight, outRight);
+			m_Nodes[node].right = newRight;
+			Update(node);
+			outLeft = node;
+		}
+		else
+		{
+			// Cut the piece, the tail becomes a new piece merged in front of the right subtree.
+			const uint32_t cut = (uint32_t)(offset - leftLength);
+			const uint32_t tail = NewNode(m_Nodes[node].start + cut, m_Nodes[node].length - cut);
+			const uint32_t right = m_Nodes[node].right;
+			m_Nodes[node].length = cut;
+			m_Nodes[node].right = m_sNull;
+			Update(node);
+			outLeft = node;
+			outRight = Merge(tail, right);
+		}
+	}
+
+	// Joins two trees where all of 'left' comes before all of 'right'.
+	uint32_t Merge(uint32_t left, uint32_t right)
+	{
+		if (left == m_sNull)
+			return right;
+		if (right == m_sNull)
+			return left;
+
+		if (m_Nodes[left].priority > m_Nodes[right].priority)
+		{
+			const uint32_t merged = Merge(m_Nodes[left].right, right);
+			m_Nodes[left].right = merged;
+			Update(left);
+			return left;
+		}
+
+		const uint32_t merged = Merge(left, m_Nodes[right].left);
+		m_Nodes[right].left = merged;
+		Update(right);
+		return right;
+	}
+
+	uint32_t Rightmost(uint32_t node) const
+	{
+		if (node == m_sNull)
+			return m_sNull;
+		while (m_Nodes[node].right != m_sNull)
+			node = m_Nodes[node].right;
+		return node;
+	}
+
+	void ExtendRightmost(uint32_t node, uint32_t count)
+	{
+		while (node != m_sNull)
+		{
+			m_Nodes[node].subtreeLength += count;
+			if (m_Nodes[node].right == m_sNull)
+				m_Nodes[node].length += count;
+			node = m_Nodes[node].right;
+		}
+	}
+
+	void Update(uint32_t node)
+	{
+		Node& n = m_Nodes[node];
+		n.subtreeLength = SubtreeLength(n.left) + n.length + SubtreeLength(n.right);
+	}
+
+	size_t SubtreeLength(uint32_t node) const { return node != m_sNull ? m_Nodes[node].subtreeLength : 0; }
+
+	uint32_t NewNode(uint32_t start, uint32_t length)
+	{
+		uint32_t node;
+		if (!m_FreeNodes.empty())
+		{
+			node = m_FreeNodes.back();
+			m_FreeNodes.pop_back();
+		}
+		else
+		{
+			node = (uint32_t)m_Nodes.size();
+			m_Nodes.emplace_back();
+		}
+
+		Node& n = m_Nodes[node];
+		n.start = start;
+		n.length = length;
+		n.subtreeLength = length;
+		n.priority = NextPriority();
+		n.left = m_sNull;
+		n.right = m_sNull;
+		return node;
+	}
+
+	void FreeSubtree(uint32_t node)
+	{
+		if (node == m_sNull)
+			return;
+		FreeSubtree(m_Nodes[node].left);
+		FreeSubtree(m_Nodes[node].right);
+		m_FreeNodes.push_back(node);
+	}
+
+	void CopySubtree(uint32_t node, Type*& pDest) const
+	{
+		if (node == m_sNull)
+			return;
+		const Node& n = m_Nodes[node];
+		CopySubtree(n.left, pDest);
+		std::memcpy(pDest, m_Data.data() + n.start, sizeof(Type) * n.length);
+		pDest += n.length;
+		CopySubtree(n.right, pDest);
+	}
+
+	// Xorshift, the priorities only need to be well spread.
+	uint32_t NextPriority()
+	{
+		m_PriorityState ^= m_PriorityState << 13;
+		m_PriorityState ^= m_PriorityState >> 17;
+		m_PriorityState ^= m_PriorityState << 5;
+		return m_PriorityState;
+	}
+
+private:
+	inline static constexpr uint32_t m_sNull = UINT32_MAX;
+	inline static constexpr size_t m_sCompactMinCount = 1u << 20; // Erased bytes are only reclaimed once there is at least this much.
+
+	std::vector<Type> m_Data; // Add-only, pieces refer to ranges in it.
+	std::vector<Node> m_Nodes;
+	std::vector<uint32_t> m_FreeNodes;
+	uint32_t m_Root = m_sNull;
+	size_t m_DeadCount = 0;
+	uint32_t m_PriorityState = 0x9E3779B9u;
+};
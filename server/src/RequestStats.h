@@ -0,0 +1,193 @@
+#pragma once
+
+#include <lsp/messages.h>
+
+#include <string>
+#include <string_view>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <format>
+#include <type_traits>
+
+#include "LatencyHistogram.h"
+#include "AsyncInputStream.h"
+
+// Latencies of the messages of one method.
+struct MethodStats
+{
+	LatencyHistogram queueWait;		// From the message being received until its handler started, decoding included.
+	LatencyHistogram processing;	// Running the handler on the message thread.
+	LatencyHistogram total;			// From the message being received until its handler returned, queue wait and processing of each message together.
+	LatencyHistogram serialization;	// From the handler returning until the reply was queued for writing, for requests replied to right away.
+};
+
+// Latencies of all handled messages by method, filled in by TimedHandlers.
+struct RequestStats
+{
+public:
+	MethodStats& GetMethodStats(std::string_view method)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto it = m_Methods.find(method);
+		if (it == m_Methods.end())
+			it = m_Methods.emplace(std::string(method), std::make_unique<MethodStats>()).first;
+		return *it->second;
+	}
+
+	// A request handler returned, the reply is serialized and written through the output stream next, on the same thread.
+	void BeginSerialization(MethodStats& stats)
+	{
+		m_sSerializing = Serializing{ &stats, std::chrono::steady_clock::now() };
+	}
+
+	// Called by the output stream for every message written through it.
+	void OnMessageWritten()
+	{
+		if (m_sSerializing.pStats == nullptr)
+			return;
+		m_sSerializing.pStats->serialization.Record(std::chrono::steady_clock::now() - m_sSerializing.start);
+		m_sSerializing.pStats = nullptr;
+	}
+
+	// A $/cancelRequest reached a request that was still running.
+	void RecordCancelled() { m_CancelledCount.fetch_add(1, std::memory_order_relaxed); }
+
+	// {"methods":{"textDocument/didChange":{"queueWait":{...},"processing":{...},"total":{...},"serialization":{...}}},"cancelled":2}
+	std::string ToJson()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::string methods;
+		for (const auto& [method, pStats] : m_Methods)
+		{
+			methods += std::format(R"({}"{}":{{"queueWait":{},"processing":{},"total":{},"serialization":{}}})", methods.empty() ? "" : ",",
+				method, pStats->queueWait.ToJson(), pStats->processing.ToJson(), pStats->total.ToJson(), pStats->serialization.ToJson());
+		}
+		return std::format(R"({{"methods":{{{}}},"cancelled":{}}})", methods, m_CancelledCount.load(std::memory_order_relaxed));
+	}
+
+	// One line for the log: "textDocument/didChange n=120 p50=35.0us p99=410.0us, ..." of the time from receiving a message until it was handled.
+	std::string GetSummary()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::string summary;
+		for (const auto& [method, pStats] : m_Methods)
+		{
+			if (pStats->total.GetCount() == 0)
+				continue;
+			summary += std::format("{}{} n={} p50={:.1f}us p99={:.1f}us", summary.empty() ? "" : ", ", method, pStats->total.GetCount(),
+				LatencyHistogram::ToMicroseconds(pStats->total.GetPercentile(0.5)), LatencyHistogram::ToMicroseconds(pStats->total.GetPercentile(0.99)));
+		}
+		return summary.empty() ? "No messages handled" : summary;
+	}
+
+private:
+	struct Serializing
+	{
+		MethodStats* pStats; // nullptr if no reply is being serialized.
+		std::chrono::steady_clock::time_point start;
+	};
+
+private:
+	// Replies written on other threads, e.g. of requests that returned a future, are not matched to a handler.
+	inline static thread_local Serializing m_sSerializing;
+
+	std::mutex m_Mutex;
+	std::map<std::string, std::unique_ptr<MethodStats>, std::less<>> m_Methods;
+	std::atomic<uint64_t> m_CancelledCount = 0;
+};
+
+// Registers handlers with the request handler of lsp-framework like it does, timing each message of the method:
+//
+//   TimedHandlers(messageHandler.requestHandler(), stats, input)
+//       .add<lsp::requests::Initialize>([](const lsp::jsonrpc::MessageId& id, lsp::requests::Initialize::Params&& params) { ... })
+//
+// Handlers that return a future are timed until they return, their reply is written on another thread once it is ready.
+template<typename Table>
+struct TimedHandlers
+{
+public:
+	TimedHandlers(Table& table, RequestStats& stats, AsyncInputStream& input) : m_Table(table), m_Stats(stats), m_Input(input) {}
+
+	template<typename Message, typename Handler>
+	TimedHandlers& add(Handler handler)
+	{
+		MethodStats* pMethodStats = &m_Stats.GetMethodStats(Message::Method);
+		RequestStats& stats = m_Stats;
+		AsyncInputStream& input = m_Input;
+		constexpr bool isRequest = requires { typename Message::Result; };
+
+		if constexpr (isRequest && requires { typename Message::Params; })
+		{
+			m_Table.template add<Message>([=, &stats, &input, handler = std::move(handler)](const lsp::jsonrpc::MessageId& id, typename Message::Params&& params) mutable
+				{
+					return Time(stats, input, *pMethodStats, isRequest, [&]() { return handler(id, std::move(params)); });
+				});
+		}
+		else if constexpr (isRequest)
+		{
+			m_Table.template add<Message>([=, &stats, &input, handler = std::move(handler)](const lsp::jsonrpc::MessageId& id) mutable
+				{
+					return Time(stats, input, *pMethodStats, isRequest, [&]() { return handler(id); });
+				});
+		}
+		else if constexpr (requires { typename Message::Params; })
+		{
+			m_Table.template add<Message>([=, &stats, &input, handler = std::move(handler)](typename Message::Params&& params) mutable
+				{
+					return Time(stats, input, *pMethodStats, isRequest, [&]() { return handler(std::move(params)); });
+				});
+		}
+		else
+		{
+			m_Table.template add<Message>([=, &stats, &input, handler = std::move(handler)]() mutable
+				{
+					return Time(stats, input, *pMethodStats, isRequest, [&]() { return handler(); });
+				});
+		}
+		return *this;
+	}
+
+private:
+	template<typename T>
+	struct IsFuture : std::false_type {};
+	template<typename T>
+	struct IsFuture<std::future<T>> : std::true_type {};
+
+	// Records the time from the arrival of the message until the handler started, how long the handler ran, thrown errors included, and both together.
+	template<typename Function>
+	static auto Time(RequestStats& stats, AsyncInputStream& input, MethodStats& methodStats, bool isRequest, Function&& function) -> decltype(function())
+	{
+		struct Finish
+		{
+			RequestStats& stats;
+			MethodStats& methodStats;
+			std::chrono::steady_clock::time_point arrival;
+			std::chrono::steady_clock::time_point start;
+			bool writesReply;
+
+			~Finish()
+			{
+				const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+				methodStats.processing.Record(end - start);
+				methodStats.total.Record(end - arrival);
+				if (writesReply)
+					stats.BeginSerialization(methodStats);
+			}
+		};
+
+		const std::chrono::steady_clock::time_point arrival = input.GetArrivalTime();
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		methodStats.queueWait.Record(start - arrival);
+		Finish finish{ stats, methodStats, arrival, start, isRequest && !IsFuture<decltype(function())>::value };
+		return function();
+	}
+
+private:
+	Table& m_Table;
+	RequestStats& m_Stats;
+	AsyncInputStream& m_Input;
+};
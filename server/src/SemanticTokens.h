@@ -0,0 +1,297 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "TextStorage.h"
+#include "LineIndex.h"
+#include "TreeChanges.h"
+#include "TreeWalk.h"
+#include "Trace.h"
+
+// Semantic tokens of a document (textDocument/semanticTokens), for the HLSL constructs the TextMate grammar of the client cannot tell apart.
+// The tokens are kept encoded the way they are sent, five numbers per token:
+//
+//   deltaLine, deltaStart, length, type, modifiers		<- Line, and start if on the same line, relative to the previous token.
+//
+// Since every token is relative to the one before it, a change only affects the tokens on the lines it touched and the first token after them.
+// After a reparse only those lines are walked again (see TreeChanges) and the rest is copied as it is.
+struct SemanticTokens
+{
+public:
+	// In the order of GetTypeNames().
+	enum class TokenType : uint32_t
+	{
+		Keyword,	// cbuffer, discard, in, out, inout
+		Modifier,	// qualifiers: precise, groupshared, nointerpolation, ...
+		Type,
+		Struct,		// The name of a cbuffer.
+		Macro,		// semantics: SV_Position, TEXCOORD0, ...
+		Decorator,	// hlsl_attribute: [numthreads(8, 8, 1)], [unroll], ...
+	};
+
+	// Bits, in the order of GetModifierNames().
+	enum TokenModifier : uint32_t
+	{
+		Declaration = 1 << 0,
+	};
+
+	static std::vector<std::string> GetTypeNames() { return { "keyword", "modifier", "type", "struct", "macro", "decorator" }; }
+	static std::vector<std::string> GetModifierNames() { return { "declaration" }; }
+
+	bool IsBuilt() const { return m_Built; }
+	const std::vector<uint32_t>& GetData() const { return m_Data; }
+
+	// Drops the tokens, the next request builds them again. The last result sent is kept to answer deltas against it.
+	void Clear()
+	{
+		m_Built = false;
+		m_Starts.clear();
+		m_Data.clear();
+	}
+
+	// Walks the whole tree.
+	void Build(TSNode root, const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding)
+	{
+		MSLP_TRACE_ZONE("Semantic tokens");
+		std::vector<Token> tokens;
+		Collect(root, lines, 0, UINT32_MAX, tokens);
+		m_Starts.clear();
+		m_Data.clear();
+		Append(tokens, storage, lines, encoding, m_Starts, m_Data);
+		m_Built = true;
+	}
+
+	// Brings the tokens up to date with a new tree, walking only the lines that changed.
+	// edits: Applied to the old tree since the tokens were last updated, in order.
+	// pChangedRanges: From ts_tree_get_changed_ranges between the old and the new tree.
+	void Update(TSNode root, const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding, const std::vector<TSInputEdit>& edits, const TSRange* pChangedRanges, uint32_t changedRangeCount)
+	{
+		if (!m_Built)
+			return;
+		MSLP_TRACE_ZONE("Semantic tokens");
+
+		// Moves the tokens after each edit. Tokens in the erased text end up at its start, on a line that is walked again.
+		for (const TSInputEdit& edit : edits)
+		{
+			for (auto it = std::lower_bound(m_Starts.begin(), m_Starts.end(), edit.start_byte); it != m_Starts.end(); ++it)
+				*it = TreeChanges::MoveOffset(*it, edit);
+		}
+
+		const std::vector<TreeChanges::Span> spans = TreeChanges::GetChangedLines(lines, edits, pChangedRanges, changedRangeCount);
+		if (spans.empty())
+			return;
+
+		// The tokens between the spans are copied, only the first one after each span is encoded again.
+		std::vector<uint32_t> starts;
+		std::vector<uint32_t> data;
+		starts.reserve(m_Starts.size());
+		data.reserve(m_Data.size());
+		std::vector<Token> tokens;
+		size_t copied = 0;
+		for (const TreeChanges::Span& span : spans)
+		{
+			const size_t first = std::lower_bound(m_Starts.begin() + copied, m_Starts.end(), span.start) - m_Starts.begin();
+			const size_t last = std::lower_bound(m_Starts.begin() + first, m_Starts.end(), span.end) - m_Starts.begin();
+			Copy(copied, first, storage, lines, encoding, starts, data);
+
+			tokens.clear();
+			Collect(root, lines, span.start, span.end, tokens);
+			Append(tokens, storage, lines, encoding, starts, data);
+			copied = last;
+		}
+		Copy(copied, m_Starts.size(), storage, lines, encoding, starts, data);
+
+		m_Starts.swap(starts);
+		m_Data.swap(data);
+	}
+
+	// The encoded tokens that start in [startByte, endByte).
+	void GetRange(const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding, size_t startByte, size_t endByte, std::vector<uint32_t>& outData) const
+	{
+		const size_t first = std::lower_bound(m_Starts.begin(), m_Starts.end(), startByte) - m_Starts.begin();
+		const size_t last = std::lower_bound(m_Starts.begin() + first, m_Starts.end(), endByte) - m_Starts.begin();
+		outData.assign(m_Data.begin() + first * 5, m_Data.begin() + last * 5);
+		if (first == last)
+			return;
+
+		// The first token is relative to the start of the document.
+		uint32_t line, character;
+		lines.OffsetToPosition(storage, m_Starts[first], encoding, line, character);
+		outData[0] = line;
+		outData[1] = character;
+	}
+
+	// Remembers the tokens as the last result sent to the client, the next delta request is answered relative to it. Returns the id of the result.
+	std::string SaveResult()
+	{
+		m_SentData = m_Data;
+		return std::to_string(++m_ResultId);
+	}
+
+	// Finds what changed since the last result sent, as one edit of its data covering everything between the unchanged tokens at the start and the end.
+	// Returns false if the client does not have the last result, it then gets all tokens.
+	bool GetEdit(const std::string& previousResultId, uint32_t& outStart, uint32_t& outDeleteCount, std::vector<uint32_t>& outData) const
+	{
+		if (m_ResultId == 0 || previousResultId != std::to_string(m_ResultId))
+			return false;
+
+		const size_t count = std::min(m_SentData.size(), m_Data.size());
+		size_t prefix = std::mismatch(m_SentData.begin(), m_SentData.begin() + count, m_Data.begin()).first - m_SentData.begin();
+		prefix -= prefix % 5;
+		size_t suffix = std::mismatch(m_SentData.rbegin(), m_SentData.rbegin() + (count - prefix), m_Data.rbegin()).first - m_SentData.rbegin();
+		suffix -= suffix % 5;
+
+		outStart = (uint32_t)prefix;
+		outDeleteCount = (uint32_t)(m_SentData.size() - prefix - suffix);
+		outData.assign(m_Data.begin() + prefix, m_Data.end() - suffix);
+		return true;
+	}
+
+private:
+	// Token in bytes, always within one line.
+	struct Token
+	{
+		uint32_t start;
+		uint32_t end;
+		TokenType type;
+		uint32_t modifiers;
+	};
+
+	// Adds the tokens of the nodes it visits.
+	struct TokenVisitor
+	{
+		using Kinds = TreeWalk::KindList<NodeKind::KeywordCbuffer, NodeKind::KeywordDiscard, NodeKind::KeywordIn, NodeKind::KeywordOut, NodeKind::KeywordInout,
+			NodeKind::Qualifiers, NodeKind::Semantics, NodeKind::HlslAttribute, NodeKind::TypeIdentifier, NodeKind::PrimitiveType>;
+
+		const LineIndex& lines;
+		uint32_t startByte;
+		std::vector<Token>& outTokens;
+
+		template<NodeKind Kind>
+		TreeWalk::Action On(const TreeWalk::Node& node)
+		{
+			const NodeKindTable& table = NodeKindTable::Get();
+			if constexpr (Kind == NodeKind::Qualifiers)
+			{
+				Add(node.node, TokenType::Modifier, 0);
+			}
+			else if constexpr (Kind == NodeKind::Semantics)
+			{
+				const TSNode name = ts_node_named_child(node.node, 0);
+				if (!ts_node_is_null(name) && table.GetKind(name) == NodeKind::Identifier)
+					Add(name, TokenType::Macro, 0);
+			}
+			else if constexpr (Kind == NodeKind::HlslAttribute)
+			{
+				// [unroll] or [numthreads(8, 8, 1)]
+				TSNode name = ts_node_named_child(node.node, 0);
+				if (!ts_node_is_null(name) && table.GetKind(name) == NodeKind::CallExpression)
+					name = ts_node_child_by_field_id(name, table.GetFieldId(FieldKind::Function));
+				if (!ts_node_is_null(name) && table.GetKind(name) == NodeKind::Identifier)
+					Add(name, TokenType::Decorator, 0);
+			}
+			else if constexpr (Kind == NodeKind::TypeIdentifier)
+			{
+				if (node.GetField() == FieldKind::Name && table.GetKind(ts_node_parent(node.node)) == NodeKind::CbufferSpecifier)
+					Add(node.node, TokenType::Struct, TokenModifier::Declaration);
+				else
+					Add(node.node, TokenType::Type, 0);
+			}
+			else if constexpr (Kind == NodeKind::PrimitiveType)
+			{
+				Add(node.node, TokenType::Type, 0);
+			}
+			else
+			{
+				Add(node.node, TokenType::Keyword, 0);
+			}
+			return TreeWalk::Action::SkipChildren;
+		}
+
+		// Tokens cannot span lines, the token of a node that does is cut at the end of its first line.
+		void Add(TSNode node, TokenType type, uint32_t modifiers)
+		{
+			const uint32_t start = ts_node_start_byte(node);
+			if (start < startByte)
+				return;
+			const uint32_t line = lines.LineAt(start);
+			const uint32_t end = std::min(ts_node_end_byte(node), (uint32_t)(lines.LineStart(line) + lines.LineLength(line)));
+			if (end > start)
+				outTokens.push_back(Token{ start, end, type, modifiers });
+		}
+	};
+
+	// Adds the tokens that start in [startByte, endByte) in order, only visiting the subtrees that overlap the range.
+	static void Collect(TSNode root, const LineIndex& lines, uint32_t startByte, uint32_t endByte, std::vector<Token>& outTokens)
+	{
+		TokenVisitor visitor{ lines, startByte, outTokens };
+		TreeWalk::Walk(root, visitor, startByte, endByte);
+	}
+
+	// Encodes tokens after the last one in the data.
+	static void Append(const std::vector<Token>& tokens, const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding, std::vector<uint32_t>& starts, std::vector<uint32_t>& data)
+	{
+		uint32_t previousLine = 0;
+		uint32_t previousCharacter = 0;
+		if (!starts.empty())
+			lines.OffsetToPosition(storage, starts.back(), encoding, previousLine, previousCharacter);
+
+		for (const Token& token : tokens)
+		{
+			uint32_t line, character;
+			lines.OffsetToPosition(storage, token.start, encoding, line, character);
+			uint32_t length = token.end - token.start;
+			if (encoding != PositionEncoding::UTF8 && !lines.IsLineAscii(line))
+			{
+				uint32_t endLine, endCharacter;
+				lines.OffsetToPosition(storage, token.end, encoding, endLine, endCharacter);
+				length = endCharacter - character;
+			}
+
+			starts.push_back(token.start);
+			Encode(line, character, length, (uint32_t)token.type, token.modifiers, previousLine, previousCharacter, data);
+		}
+	}
+
+	// Copies the tokens [first, last) after the last one in the data.
+	void Copy(size_t first, size_t last, const TextStorage& storage, const LineIndex& lines, PositionEncoding encoding, std::vector<uint32_t>& starts, std::vector<uint32_t>& data) const
+	{
+		if (first == last)
+			return;
+
+		// Encoded again since the tokens before it have changed. The length, type and modifiers are the same as its text was not edited.
+		uint32_t previousLine = 0;
+		uint32_t previousCharacter = 0;
+		if (!starts.empty())
+			lines.OffsetToPosition(storage, starts.back(), encoding, previousLine, previousCharacter);
+		uint32_t line, character;
+		lines.OffsetToPosition(storage, m_Starts[first], encoding, line, character);
+		Encode(line, character, m_Data[first * 5 + 2], m_Data[first * 5 + 3], m_Data[first * 5 + 4], previousLine, previousCharacter, data);
+
+		starts.insert(starts.end(), m_Starts.begin() + first, m_Starts.begin() + last);
+		data.insert(data.end(), m_Data.begin() + (first + 1) * 5, m_Data.begin() + last * 5);
+	}
+
+	static void Encode(uint32_t line, uint32_t character, uint32_t length, uint32_t type, uint32_t modifiers, uint32_t& previousLine, uint32_t& previousCharacter, std::vector<uint32_t>& data)
+	{
+		data.push_back(line - previousLine);
+		data.push_back(line == previousLine ? character - previousCharacter : character);
+		data.push_back(length);
+		data.push_back(type);
+		data.push_back(modifiers);
+		previousLine = line;
+		previousCharacter = character;
+	}
+
+private:
+	bool m_Built = false;
+	std::vector<uint32_t> m_Starts;	// Byte offset of each token.
+	std::vector<uint32_t> m_Data;
+	uint64_t m_ResultId = 0;
+	std::vector<uint32_t> m_SentData;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <format>
+#include <cstdint>
+#include <cstdlib>
+
+#include "MessageFrame.h"
+
+// Records every frame going to and from the server, to replay the session without an editor (see replay/Replay.cpp).
+// A recording is the frames as they were sent, each with two extra header fields in front:
+//
+// Recorded-Direction: in\r\n
+// Recorded-Time: 1523\r\n		<- Microseconds since the recording started.
+// Content-Length: 52\r\n
+// \r\n
+// {"jsonrpc":"2.0","method":"initialized","params":{}}
+struct SessionRecorder
+{
+public:
+	enum class Direction
+	{
+		In,		// Client to server.
+		Out,	// Server to client.
+	};
+
+	struct Frame
+	{
+		Direction direction;
+		uint64_t timeMicros;
+		std::string data; // The frame without the recorded header fields.
+
+		std::string_view GetBody() const { return std::string_view(data).substr(data.find("\r\n\r\n") + 4); }
+	};
+
+	// Returns false if the file could not be created.
+	bool Open(const std::string& path)
+	{
+		m_File.open(path, std::ios::binary | std::ios::trunc);
+		m_Start = std::chrono::steady_clock::now();
+		return m_File.is_open();
+	}
+
+	bool IsOpen() const { return m_File.is_open(); }
+
+	// Can be called from any thread. Frames are flushed as they are written, so a crash leaves everything up to it in the recording.
+	void Record(Direction direction, std::string_view frame)
+	{
+		const uint64_t timeMicros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_Start).count();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_File << std::format("Recorded-Direction: {}\r\nRecorded-Time: {}\r\n", direction == Direction::In ? "in" : "out", timeMicros);
+		m_File.write(frame.data(), (std::streamsize)frame.size());
+		m_File.flush();
+	}
+
+	// Reads a recording into outFrames. Returns false if the file could not be read, a truncated last frame is left out.
+	static bool Read(const std::string& path, std::vector<Frame>& outFrames)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::stringstream content;
+		content << file.rdbuf();
+		const std::string input = content.str();
+
+		size_t frameStart = 0;
+		size_t bodyStart;
+		size_t frameEnd;
+		while ((frameEnd = MessageFrame::FindEnd(input, frameStart, bodyStart)) != std::string::npos)
+		{
+			const std::string_view header = std::string_view(input).substr(frameStart, bodyStart - frameStart);
+			const std::string time(MessageFrame::FindHeaderField(header, "Recorded-Time"));
+
+			Frame frame;
+			frame.direction = MessageFrame::FindHeaderField(header, "Recorded-Direction") == "out" ? Direction::Out : Direction::In;
+			frame.timeMicros = std::strtoull(time.c_str(), nullptr, 10);
+			frame.data = std::format("Content-Length: {}\r\n\r\n", frameEnd - bodyStart) + input.substr(bodyStart, frameEnd - bodyStart);
+			outFrames.push_back(std::move(frame));
+			frameStart = frameEnd;
+		}
+		return true;
+	}
+
+private:
+	std::mutex m_Mutex;
+	std::ofstream m_File;
+	std::chrono::steady_clock::time_point m_Start;
+};
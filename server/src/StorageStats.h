@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts the bytes moved around inside the text storages.
+// Only counted in builds that define MSLP_STORAGE_STATS (the benchmark), otherwise the macros compile to nothing.
+struct StorageStats
+{
+	inline static size_t s_CopiedBytes = 0;
+};
+
+#ifdef MSLP_STORAGE_STATS
+	#define MSLP_STORAGE_COPIED(count) (StorageStats::s_CopiedBytes += (count))
+#else
+	#define MSLP_STORAGE_COPIED(count) ((void)0)
+#endif
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <coroutine>
+#include <future>
+#include <exception>
+
+#include "EventLoop.h"
+#include "CancellationToken.h"
+
+// Coroutine for request handlers that have to wait for something, a parse for example, without blocking the message thread.
+// The coroutine starts right away on the calling thread and runs until its first co_await that has to wait,
+// the handler returns the future that the result ends up in, which lsp-framework replies with once it is ready:
+//
+//   Task<Result> HandleRequest(...)
+//   {
+//       DocumentSnapshotPtr pSnapshot = co_await waiters.WaitForTree(uri, token);
+//       co_return result;
+//   }
+//   ...add<Request>([](id, params) { return HandleRequest(...).GetFuture(); })
+//
+// Awaiters resume the coroutine on the message thread (see EventLoop), so handlers can use the documents like synchronous ones.
+// An exception thrown by the coroutine, e.g. lsp::RequestError, is stored in the future.
+template<typename T>
+struct Task
+{
+public:
+	struct promise_type
+	{
+		std::promise<T> promise;
+
+		Task get_return_object() { return Task(promise.get_future()); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; } // The frame frees itself once the result is set.
+		void return_value(T value) { promise.set_value(std::move(value)); }
+		void unhandled_exception() { promise.set_exception(std::current_exception()); }
+	};
+
+	std::future<T> GetFuture() { return std::move(m_Future); }
+
+private:
+	Task(std::future<T>&& future) : m_Future(std::move(future)) {}
+
+	std::future<T> m_Future;
+};
+
+template<>
+struct Task<void>
+{
+public:
+	struct promise_type
+	{
+		std::promise<void> promise;
+
+		Task get_return_object() { return Task(promise.get_future()); }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() { promise.set_value(); }
+		void unhandled_exception() { promise.set_exception(std::current_exception()); }
+	};
+
+	std::future<void> GetFuture() { return std::move(m_Future); }
+
+private:
+	Task(std::future<void>&& future) : m_Future(std::move(future)) {}
+
+	std::future<void> m_Future;
+};
+
+// co_await Yield(loop, token): Lets the message thread handle other messages before the coroutine continues,
+// for long loops on the message thread. Throws RequestCancelled if the request was cancelled in the meantime.
+struct Yield
+{
+public:
+	Yield(EventLoop& loop, CancellationToken token) : m_Loop(loop), m_Token(std::move(token)) {}
+
+	bool await_ready() const { return false; }
+	void await_suspend(std::coroutine_handle<> handle) { m_Loop.Post([handle]() { handle.resume(); }); }
+	void await_resume() const { m_Token.ThrowIfCancelled(); }
+
+private:
+	EventLoop& m_Loop;
+	CancellationToken m_Token;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Replaces [start, start + eraseCount) with the data.
+// In a batch, all offsets refer to the text before the batch and the edits may not overlap.
+struct TextEdit
+{
+	size_t start = 0;
+	size_t eraseCount = 0;
+	const uint8_t* pData = nullptr;
+	size_t dataCount = 0;
+};
@@ -0,0 +1,219 @@
+#include "TextScan.h"
+
+#include <bit>
+#include <random>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define MSLP_TEXTSCAN_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define MSLP_TARGET_AVX2
+	#else
+		#define MSLP_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+namespace
+{
+	struct Kernels
+	{
+		size_t (*countNewlines)(const uint8_t*, size_t);
+		size_t (*findNewline)(const uint8_t*, size_t);
+		bool (*isAscii)(const uint8_t*, size_t);
+		const char* pName;
+	};
+
+	// ------------------- Scalar -------------------
+
+	size_t CountNewlinesScalar(const uint8_t* pData, size_t count)
+	{
+		size_t newlines = 0;
+		for (size_t i = 0; i < count; ++i)
+			newlines += pData[i] == '\n';
+		return newlines;
+	}
+
+	size_t FindNewlineScalar(const uint8_t* pData, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (pData[i] == '\n')
+				return i;
+		}
+		return count;
+	}
+
+	bool IsAsciiScalar(const uint8_t* pData, size_t count)
+	{
+		uint8_t bits = 0;
+		for (size_t i = 0; i < count; ++i)
+			bits |= pData[i];
+		return (bits & 0x80) == 0;
+	}
+
+#ifdef MSLP_TEXTSCAN_X86
+	// ------------------- SSE2 -------------------
+	// Part of x64, no detection needed. The tail that does not fill a register is handled by the scalar kernels.
+
+	size_t CountNewlinesSSE2(const uint8_t* pData, size_t count)
+	{
+		const __m128i newline = _mm_set1_epi8('\n');
+		size_t newlines = 0;
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i bytes = _mm_loadu_si128((const __m128i*)(pData + i));
+			newlines += std::popcount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+		}
+		return newlines + CountNewlinesScalar(pData + i, count - i);
+	}
+
+	size_t FindNewlineSSE2(const uint8_t* pData, size_t count)
+	{
+		const __m128i newline = _mm_set1_epi8('\n');
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			const __m128i bytes = _mm_loadu_si128((const __m128i*)(pData + i));
+			const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+			if (mask != 0)
+				return i + std::countr_zero(mask);
+		}
+		return i + FindNewlineScalar(pData + i, count - i);
+	}
+
+	bool IsAsciiSSE2(const uint8_t* pData, size_t count)
+	{
+		__m128i bits = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+			bits = _mm_or_si128(bits, _mm_loadu_si128((const __m128i*)(pData + i)));
+		return _mm_movemask_epi8(bits) == 0 && IsAsciiScalar(pData + i, count - i);
+	}
+
+	// ------------------- AVX2 -------------------
+
+	MSLP_TARGET_AVX2 size_t CountNewlinesAVX2(const uint8_t* pData, size_t count)
+	{
+		const __m256i newline = _mm256_set1_epi8('\n');
+		size_t newlines = 0;
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			const __m256i bytes = _mm256_loadu_si256((const __m256i*)(pData + i));
+			newlines += std::popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline)));
+		}
+		return newlines + CountNewlinesSSE2(pData + i, count - i);
+	}
+
+	MSLP_TARGET_AVX2 size_t FindNewlineAVX2(const uint8_t* pData, size_t count)
+	{
+		const __m256i newline = _mm256_set1_epi8('\n');
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			const __m256i bytes = _mm256_loadu_si256((const __m256i*)(pData + i));
+			const uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, newline));
+			if (mask != 0)
+				return i + std::countr_zero(mask);
+		}
+		return i + FindNewlineSSE2(pData + i, count - i);
+	}
+
+	MSLP_TARGET_AVX2 bool IsAsciiAVX2(const uint8_t* pData, size_t count)
+	{
+		__m256i bits = _mm256_setzero_si256();
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32)
+			bits = _mm256_or_si256(bits, _mm256_loadu_si256((const __m256i*)(pData + i)));
+		return _mm256_movemask_epi8(bits) == 0 && IsAsciiSSE2(pData + i, count - i);
+	}
+
+	bool SupportsAVX2()
+	{
+	#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// The OS needs to save the YMM registers (OSXSAVE and XCR0 bits 1 and 2).
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+	#else
+		return __builtin_cpu_supports("avx2");
+	#endif
+	}
+#endif
+
+	// Every kernel set the CPU can run, the fastest last.
+	std::vector<Kernels> GetSupportedKernels()
+	{
+		std::vector<Kernels> kernels;
+		kernels.push_back({ &CountNewlinesScalar, &FindNewlineScalar, &IsAsciiScalar, "Scalar" });
+#ifdef MSLP_TEXTSCAN_X86
+		kernels.push_back({ &CountNewlinesSSE2, &FindNewlineSSE2, &IsAsciiSSE2, "SSE2" });
+		if (SupportsAVX2())
+			kernels.push_back({ &CountNewlinesAVX2, &FindNewlineAVX2, &IsAsciiAVX2, "AVX2" });
+#endif
+		return kernels;
+	}
+
+	const Kernels& GetKernels()
+	{
+		static const Kernels s_Kernels = GetSupportedKernels().back();
+		return s_Kernels;
+	}
+}
+
+size_t TextScan::CountNewlines(const uint8_t* pData, size_t count) { return GetKernels().countNewlines(pData, count); }
+size_t TextScan::FindNewline(const uint8_t* pData, size_t count) { return GetKernels().findNewline(pData, count); }
+bool TextScan::IsAscii(const uint8_t* pData, size_t count) { return GetKernels().isAscii(pData, count); }
+const char* TextScan::GetKernelName() { return GetKernels().pName; }
+
+const char* TextScan::VerifyKernels(uint32_t seed, size_t roundCount)
+{
+	const std::vector<Kernels> kernels = GetSupportedKernels();
+	const Kernels& scalar = kernels.front();
+
+	// Long enough for a few AVX2 loops and their tails.
+	constexpr size_t maxCount = 300;
+	std::mt19937 random(seed);
+	std::vector<uint8_t> buffer(maxCount + 64);
+	for (size_t round = 0; round < roundCount; ++round)
+	{
+		// Every length and alignment, so the vector loops and the tails after them are both covered.
+		const size_t offset = random() % 64;
+		const size_t count = random() % maxCount;
+		// Rare enough that the first one is often past the first few vectors, and left out every other round.
+		const bool newlines = (round & 1) != 0;
+		const bool highBytes = (round & 2) != 0;
+		uint8_t* pData = buffer.data() + offset;
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t value = random();
+			if (newlines && value % 64 == 0)
+				pData[i] = '\n';
+			else if (highBytes && value % 64 == 1)
+				pData[i] = (uint8_t)(0x80 | (value >> 8));
+			else
+				pData[i] = (uint8_t)(' ' + (value >> 8) % 95);
+		}
+
+		for (const Kernels& kernel : kernels)
+		{
+			if (kernel.countNewlines(pData, count) != scalar.countNewlines(pData, count) ||
+				kernel.findNewline(pData, count) != scalar.findNewline(pData, count) ||
+				kernel.isAscii(pData, count) != scalar.isAscii(pData, count))
+				return kernel.pName;
+		}
+	}
+	return nullptr;
+}
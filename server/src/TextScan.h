@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "TextStorage.h"
+
+// Byte scanning kernels for document text. The best kernel for the CPU (AVX2, SSE2 or scalar) is picked on first use.
+namespace TextScan
+{
+	// Number of '\n' in the data.
+	size_t CountNewlines(const uint8_t* pData, size_t count);
+
+	// Index of the first '\n', or count if there is none.
+	size_t FindNewline(const uint8_t* pData, size_t count);
+
+	// True if no byte has the high bit set.
+	bool IsAscii(const uint8_t* pData, size_t count);
+
+	// Name of the selected kernel set, "AVX2", "SSE2" or "Scalar".
+	const char* GetKernelName();
+
+	// Runs every kernel set the CPU supports on random data and compares the results against the scalar kernels.
+	// Returns the name of the first set that disagrees, nullptr if all agree.
+	const char* VerifyKernels(uint32_t seed, size_t roundCount);
+
+	// Number of '\n' in [start, end) of the storage, scanning it a chunk (the spans of a GapBuffer, the pieces of a PieceTree) at a time.
+	inline size_t CountNewlines(const TextStorage& storage, size_t start, size_t end)
+	{
+		size_t newlines = 0;
+		const TextStorage::Type* pChunk = nullptr;
+		while (start < end)
+		{
+			size_t chunkCount = storage.GetChunk(start, pChunk);
+			if (chunkCount == 0)
+				break;
+			if (chunkCount > end - start)
+				chunkCount = end - start;
+			newlines += CountNewlines(pChunk, chunkCount);
+			start += chunkCount;
+		}
+		return newlines;
+	}
+}
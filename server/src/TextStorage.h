@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <algorithm> // stable_sort
+
+#include "TextEdit.h"
+
+enum class TextStorageKind
+{
+	Auto,		// Picked per document from its size and edit pattern.
+	GapBuffer,	// Fast for localized edits such as typing.
+	PieceTree,	// O(log n) edits anywhere, for large documents and scattered edits.
+};
+
+// Common interface of the document text backends. All indices are byte offsets into the text.
+struct TextStorage
+{
+public:
+	using Type = uint8_t;
+
+	virtual ~TextStorage() {}
+
+	// index: The index before it will be inserted.
+	virtual void Insert(size_t index, const Type* pData, size_t dataCount) = 0;
+	virtual void Erase(size_t index, size_t count) = 0;
+
+	// Applies a batch of edits.
+	// pEdits: Offsets refer to the text before the batch. On return the edits are sorted by start,
+	//         and each start is moved to where the edit was applied, after the edits before it.
+	virtual void ApplyEdits(TextEdit* pEdits, size_t count)
+	{
+		std::stable_sort(pEdits, pEdits + count, [](const TextEdit& a, const TextEdit& b) { return a.start < b.start; });
+
+		size_t shift = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			TextEdit& edit = pEdits[i];
+			edit.start = edit.start + shift;
+			Erase(edit.start, edit.eraseCount);
+			Insert(edit.start, edit.pData, edit.dataCount);
+			shift = shift + edit.dataCount - edit.eraseCount;
+		}
+	}
+
+	virtual size_t GetCount() const = 0;
+	virtual Type At(size_t index) const = 0;
+
+	// Returns the number of contiguous elements starting at index, and a pointer to them through pOutData.
+	// Returns 0 if index is at or past the end.
+	virtual size_t GetChunk(size_t index, const Type*& pOutData) const = 0;
+
+	// Copies all elements into pDest. pDest needs to fit GetCount() elements.
+	virtual void CopyTo(Type* pDest) const = 0;
+
+	virtual TextStorageKind GetKind() const = 0;
+
+	// Deep copy, used to write to a storage that is still shared with a snapshot.
+	virtual std::unique_ptr<TextStorage> Clone() const = 0;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <cstring> // memcpy
+
+#include "TextStorage.h"
+
+// Lets tree-sitter read a TextStorage in place, returning chunks that point straight into the storage
+// (the spans on each side of the gap for a GapBuffer, the pieces of a PieceTree).
+// Note: The storage must not be modified while a parse is using the input.
+struct TextStorageInput
+{
+public:
+	TextStorageInput(const TextStorage& storage) : m_pStorage(&storage) {}
+
+	TextStorageInput(const TextStorageInput&) = delete;
+	TextStorageInput& operator=(const TextStorageInput&) = delete;
+
+	// The returned input refers to this object, it needs to outlive the parse.
+	TSInput GetInput()
+	{
+		TSInput input = {};
+		input.payload = this;
+		input.read = &Read;
+		input.encoding = TSInputEncodingUTF8;
+		return input;
+	}
+
+private:
+	// byteIndex: Offset into the text.
+	// position: The row and column of byteIndex. Not needed since the chunks are only addressed by offset.
+	static const char* Read(void* pPayload, uint32_t byteIndex, TSPoint /*position*/, uint32_t* pBytesRead)
+	{
+		TextStorageInput& self = *(TextStorageInput*)pPayload;
+		const TextStorage& storage = *self.m_pStorage;
+
+		const TextStorage::Type* pChunk = nullptr;
+		const size_t chunkCount = storage.GetChunk(byteIndex, pChunk);
+		if (chunkCount == 0)
+		{
+			// End of the text.
+			*pBytesRead = 0;
+			return "";
+		}
+
+		// tree-sitter cannot decode a UTF-8 sequence that is split over two chunks.
+		// Close to the end of a chunk, stitch it together with the start of the next one.
+		//      byteIndex
+		//          |
+		// 0 1 2 3 [4 5] | - - - - | [6 7] 8 9
+		if (chunkCount < m_sMaxSequenceCount)
+		{
+			size_t stitchCount = 0;
+			size_t index = byteIndex;
+			const TextStorage::Type* pPart = pChunk;
+			size_t partCount = chunkCount;
+			while (partCount > 0 && stitchCount < m_sMaxSequenceCount)
+			{
+				const size_t copyCount = partCount < m_sMaxSequenceCount ? partCount : m_sMaxSequenceCount;
+				std::memcpy(self.m_Stitch + stitchCount, pPart, copyCount);
+				stitchCount += copyCount;
+				index += copyCount;
+				partCount = storage.GetChunk(index, pPart);
+			}
+
+			*pBytesRead = (uint32_t)stitchCount;
+			return (const char*)self.m_Stitch;
+		}
+
+		*pBytesRead = (uint32_t)chunkCount;
+		return (const char*)pChunk;
+	}
+
+private:
+	inline static constexpr size_t m_sMaxSequenceCount = 4; // Longest UTF-8 sequence.
+
+	const TextStorage* m_pStorage = nullptr;
+	TextStorage::Type m_Stitch[m_sMaxSequenceCount * 2];
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+// Scoped zones showing where the time goes, for loading an editing session into a trace viewer (chrome://tracing, ui.perfetto.dev):
+//
+//   void Parse()
+//   {
+//       MSLP_TRACE_ZONE("Parse");
+//       ...
+//   }
+//
+// Only built with premake5 --trace, which defines MSLP_TRACE. Otherwise the macros compile to nothing.
+// Zones of all threads go to one ring buffer that keeps the most recent ones, saved as Chrome trace JSON with Trace::Save.
+
+#ifdef MSLP_TRACE
+
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <format>
+#include <cstdint>
+
+// A zone in the ring buffer of Trace.
+struct TraceEvent
+{
+	std::atomic<uint64_t> sequence = 0; // Index + 1 of the event once written.
+	std::atomic<const char*> pName = nullptr;
+	std::atomic<uint64_t> startNs = 0;
+	std::atomic<uint64_t> endNs = 0;
+	std::atomic<uint32_t> threadId = 0;
+};
+
+struct Trace
+{
+public:
+	static uint64_t GetTimeNs()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_sStart).count();
+	}
+
+	// pName: A string literal, only the pointer is stored.
+	static void Record(const char* pName, uint64_t startNs, uint64_t endNs)
+	{
+		const uint64_t index = m_sNext.fetch_add(1, std::memory_order_relaxed);
+		TraceEvent& event = m_sEvents[index % m_sCapacity];
+
+		// The sequence is 0 while the event is written, Save skips events that change while they are read.
+		event.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		event.pName.store(pName, std::memory_order_relaxed);
+		event.startNs.store(startNs, std::memory_order_relaxed);
+		event.endNs.store(endNs, std::memory_order_relaxed);
+		event.threadId.store(GetThreadId(), std::memory_order_relaxed);
+		event.sequence.store(index + 1, std::memory_order_release);
+	}
+
+	// Names the calling thread in the trace.
+	static void SetThreadName(const char* pName)
+	{
+		std::lock_guard<std::mutex> lock(m_sThreadNamesMutex);
+		m_sThreadNames[GetThreadId()] = pName;
+	}
+
+	// Writes the zones in the ring buffer as Chrome trace JSON. Can be called while zones are being recorded.
+	static bool Save(const std::string& path)
+	{
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+
+		file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+		bool first = true;
+		{
+			std::lock_guard<std::mutex> lock(m_sThreadNamesMutex);
+			for (const auto& [threadId, name] : m_sThreadNames)
+			{
+				file << (first ? "" : ",\n") << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})", threadId, name);
+				first = false;
+			}
+		}
+
+		const uint64_t end = m_sNext.load(std::memory_order_acquire);
+		const uint64_t begin = end > m_sCapacity ? end - m_sCapacity : 0;
+		for (uint64_t index = begin; index < end; ++index)
+		{
+			TraceEvent& event = m_sEvents[index % m_sCapacity];
+			const uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+			const char* pName = event.pName.load(std::memory_order_relaxed);
+			const uint64_t startNs = event.startNs.load(std::memory_order_relaxed);
+			const uint64_t endNs = event.endNs.load(std::memory_order_relaxed);
+			const uint32_t threadId = event.threadId.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence != index + 1 || event.sequence.load(std::memory_order_relaxed) != sequence)
+				continue;
+
+			// Timestamps are in microseconds.
+			file << (first ? "" : ",\n") << std::format(R"({{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})",
+				pName, threadId, startNs / 1000.0, (endNs - startNs) / 1000.0);
+			first = false;
+		}
+		file << "\n]}\n";
+		return (bool)file;
+	}
+
+private:
+	// Small numbers read better in the viewer than the ids of the system.
+	static uint32_t GetThreadId()
+	{
+		static std::atomic<uint32_t> s_NextThreadId = 1;
+		thread_local uint32_t s_ThreadId = s_NextThreadId.fetch_add(1, std::memory_order_relaxed);
+		return s_ThreadId;
+	}
+
+private:
+	inline static constexpr size_t m_sCapacity = 1 << 16;
+
+	inline static const std::chrono::steady_clock::time_point m_sStart = std::chrono::steady_clock::now();
+	inline static std::atomic<uint64_t> m_sNext = 0;
+	inline static TraceEvent m_sEvents[m_sCapacity];
+
+	inline static std::mutex m_sThreadNamesMutex;
+	inline static std::unordered_map<uint32_t, std::string> m_sThreadNames;
+};
+
+struct TraceZone
+{
+public:
+	TraceZone(const char* pName) : m_pName(pName), m_StartNs(Trace::GetTimeNs()) {}
+	~TraceZone() { Trace::Record(m_pName, m_StartNs, Trace::GetTimeNs()); }
+
+	TraceZone(const TraceZone&) = delete;
+	TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+	const char* m_pName;
+	uint64_t m_StartNs;
+};
+
+#define MSLP_TRACE_CONCAT_INNER(a, b) a##b
+#define MSLP_TRACE_CONCAT(a, b) MSLP_TRACE_CONCAT_INNER(a, b)
+#define MSLP_TRACE_ZONE(name) TraceZone MSLP_TRACE_CONCAT(traceZone, __LINE__)(name)
+#define MSLP_TRACE_THREAD(name) Trace::SetThreadName(name)
+
+#else
+
+#define MSLP_TRACE_ZONE(name) (void)0
+#define MSLP_TRACE_THREAD(name) (void)0
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "LineIndex.h"
+
+// What changed between the previous and the new tree of a document, for results that are updated after a reparse instead of built again
+// (see SemanticTokens and DiagnosticCache).
+namespace TreeChanges
+{
+	// [start, end) in bytes.
+	struct Span
+	{
+		uint32_t start;
+		uint32_t end;
+	};
+
+	// Where an offset from before the edit is after it.
+	// Offsets in the erased text move to the start of the edit, or to the end of the inserted text if 'toEnd'.
+	inline uint32_t MoveOffset(uint32_t offset, const TSInputEdit& edit, bool toEnd = false)
+	{
+		if (offset < edit.start_byte)
+			return offset;
+		if (offset >= edit.old_end_byte)
+			return offset - edit.old_end_byte + edit.new_end_byte;
+		return toEnd ? edit.new_end_byte : edit.start_byte;
+	}
+
+	// The whole lines that changed, sorted and merged: the lines whose structure changed, and the edited ones, where the text of a token
+	// can change without changing the structure. The last span ends at UINT32_MAX, so it also covers results that were at the end of erased text.
+	// edits: Applied to the previous tree since it was parsed, in order.
+	// pChangedRanges: From ts_tree_get_changed_ranges between the previous and the new tree.
+	inline std::vector<Span> GetChangedLines(const LineIndex& lines, const std::vector<TSInputEdit>& edits, const TSRange* pChangedRanges, uint32_t changedRangeCount)
+	{
+		// First and last line, inclusive.
+		struct LineSpan
+		{
+			uint32_t first;
+			uint32_t last;
+		};
+
+		std::vector<LineSpan> lineSpans;
+		for (uint32_t i = 0; i < changedRangeCount; ++i)
+			lineSpans.push_back(LineSpan{ lines.LineAt(pChangedRanges[i].start_byte), lines.LineAt(pChangedRanges[i].end_byte) });
+		for (size_t i = 0; i < edits.size(); ++i)
+		{
+			// Where the edited text is after the edits that came after it.
+			uint32_t start = edits[i].start_byte;
+			uint32_t end = edits[i].new_end_byte;
+			for (size_t j = i + 1; j < edits.size(); ++j)
+			{
+				start = MoveOffset(start, edits[j]);
+				end = MoveOffset(end, edits[j], true);
+			}
+			lineSpans.push_back(LineSpan{ lines.LineAt(start), lines.LineAt(end) });
+		}
+		if (lineSpans.empty())
+			return {};
+
+		std::sort(lineSpans.begin(), lineSpans.end(), [](const LineSpan& a, const LineSpan& b) { return a.first < b.first; });
+		size_t count = 1;
+		for (size_t i = 1; i < lineSpans.size(); ++i)
+		{
+			if (lineSpans[i].first <= lineSpans[count - 1].last + 1)
+				lineSpans[count - 1].last = std::max(lineSpans[count - 1].last, lineSpans[i].last);
+			else
+				lineSpans[count++] = lineSpans[i];
+		}
+
+		std::vector<Span> spans(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			spans[i].start = (uint32_t)lines.LineStart(lineSpans[i].first);
+			spans[i].end = lineSpans[i].last + 1 < lines.GetLineCount() ? (uint32_t)lines.LineStart(lineSpans[i].last + 1) : UINT32_MAX;
+		}
+		return spans;
+	}
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <lsp/messages.h>
+
+#include <string>
+#include <vector>
+#include <coroutine>
+#include <unordered_map>
+
+#include "DocumentManager.h"
+#include "AnalysisScheduler.h"
+#include "CancellationToken.h"
+
+// Lets coroutines wait for the tree of the current version of a document:
+//
+//   DocumentSnapshotPtr pSnapshot = co_await waiters.WaitForTree(uri, token);
+//
+// A pending analysis is flushed so the wait is not stretched by the debounce window.
+// The coroutine is resumed on the message thread when the parse is handed to the document, and throws if instead
+// the document was closed, the parse failed or the request was cancelled.
+// Note: Only used on the message thread.
+struct TreeWaiters
+{
+public:
+	struct Awaiter;
+
+	TreeWaiters(DocumentManager& documents, AnalysisScheduler& scheduler) : m_Documents(documents), m_Scheduler(scheduler) {}
+
+	// Waiting coroutines are destroyed, their futures end with a broken promise.
+	~TreeWaiters()
+	{
+		for (auto& [uri, awaiters] : m_Awaiters)
+			for (Awaiter* pAwaiter : awaiters)
+				pAwaiter->m_Handle.destroy();
+	}
+
+	TreeWaiters(const TreeWaiters&) = delete;
+	TreeWaiters& operator=(const TreeWaiters&) = delete;
+
+	Awaiter WaitForTree(const std::string& uri, CancellationToken token) { return Awaiter(*this, uri, std::move(token)); }
+
+	// A tree was handed to the document. Waiters are resumed if it is of the current version, otherwise a newer parse is on its way.
+	void OnParsed(const std::string& uri)
+	{
+		Document* pDocument = m_Documents.Get(uri);
+		if (pDocument && IsParsed(*pDocument))
+			Resume(uri, [](Awaiter&) { return true; }, Status::Ready);
+	}
+
+	// The parse of the current version was given up, waiting for it would never end.
+	void OnParseFailed(const std::string& uri, int version)
+	{
+		m_FailedVersions[uri] = version;
+		Resume(uri, [](Awaiter&) { return true; }, Status::Failed);
+	}
+
+	void OnClosed(const std::string& uri)
+	{
+		m_FailedVersions.erase(uri);
+		Resume(uri, [](Awaiter&) { return true; }, Status::Closed);
+	}
+
+	// Resumes the waiters whose request was cancelled, call after cancelling tokens.
+	void WakeCancelled()
+	{
+		std::vector<std::string> uris;
+		for (const auto& [uri, awaiters] : m_Awaiters)
+			uris.push_back(uri);
+		for (const std::string& uri : uris)
+			Resume(uri, [](Awaiter& awaiter) { return awaiter.m_Token.IsCancelled(); }, Status::Cancelled);
+	}
+
+	enum class Status
+	{
+		Waiting,
+		Ready,
+		Closed,
+		Failed,
+		Cancelled,
+	};
+
+	struct Awaiter
+	{
+	public:
+		Awaiter(TreeWaiters& waiters, const std::string& uri, CancellationToken token)
+			: m_Waiters(waiters), m_Uri(uri), m_Token(std::move(token)) {}
+
+		bool await_ready()
+		{
+			if (m_Token.IsCancelled())
+				m_Status = Status::Cancelled;
+			else if (Document* pDocument = m_Waiters.m_Documents.Get(m_Uri))
+			{
+				if (m_Waiters.IsParsed(*pDocument))
+				{
+					m_Status = Status::Ready;
+					m_pSnapshot = pDocument->GetSnapshot();
+				}
+				else if (m_Waiters.HasFailed(*pDocument))
+					m_Status = Status::Failed;
+			}
+			else
+				m_Status = Status::Closed;
+			return m_Status != Status::Waiting;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			m_Handle = handle;
+			m_Waiters.m_Awaiters[m_Uri].push_back(this);
+			m_Waiters.m_Scheduler.Flush(m_Uri);
+		}
+
+		DocumentSnapshotPtr await_resume()
+		{
+			switch (m_Status)
+			{
+			case Status::Cancelled:
+				m_Token.ThrowIfCancelled();
+				break;
+			case Status::Closed:
+				throw lsp::RequestError(static_cast<int>(lsp::LSPErrorCodes::ContentModified), "The document is not open");
+			case Status::Failed:
+				throw lsp::RequestError(static_cast<int>(lsp::LSPErrorCodes::RequestFailed), "The document could not be parsed in time");
+			default:
+				break;
+			}
+			return m_pSnapshot;
+		}
+
+	private:
+		friend struct TreeWaiters;
+
+		TreeWaiters& m_Waiters;
+		std::string m_Uri;
+		CancellationToken m_Token;
+		std::coroutine_handle<> m_Handle;
+		Status m_Status = Status::Waiting;
+		DocumentSnapshotPtr m_pSnapshot;
+	};
+
+private:
+	bool IsParsed(const Document& document) const { return document.GetTree() && document.GetAnalysis().parsedVersion == document.GetVersion(); }
+
+	bool HasFailed(const Document& document) const
+	{
+		auto it = m_FailedVersions.find(document.GetUri());
+		return it != m_FailedVersions.end() && it->second == document.GetVersion();
+	}
+
+	// Resumes the waiters of the document that match, they can start waiting again while being resumed.
+	template<typename Predicate>
+	void Resume(const std::string& uri, Predicate predicate, Status status)
+	{
+		auto it = m_Awaiters.find(uri);
+		if (it == m_Awaiters.end())
+			return;
+
+		std::vector<Awaiter*> resumed;
+		std::vector<Awaiter*>& awaiters = it->second;
+		for (size_t i = 0; i < awaiters.size();)
+		{
+			if (predicate(*awaiters[i]))
+			{
+				resumed.push_back(awaiters[i]);
+				awaiters[i] = awaiters.back();
+				awaiters.pop_back();
+			}
+			else
+				++i;
+		}
+		if (awaiters.empty())
+			m_Awaiters.erase(it);
+
+		Document* pDocument = m_Documents.Get(uri);
+		for (Awaiter* pAwaiter : resumed)
+		{
+			pAwaiter->m_Status = status;
+			if (status == Status::Ready && pDocument)
+				pAwaiter->m_pSnapshot = pDocument->GetSnapshot();
+			pAwaiter->m_Handle.resume();
+		}
+	}
+
+private:
+	DocumentManager& m_Documents;
+	AnalysisScheduler& m_Scheduler;
+	std::unordered_map<std::string, std::vector<Awaiter*>> m_Awaiters;
+	std::unordered_map<std::string, int> m_FailedVersions;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <cstdint>
+
+#include "NodeKindTable.h"
+
+// Walks a tree in order with a TSTreeCursor, calling the handler a visitor has for the kind of each node. The handlers are picked at compile time,
+// and nothing is allocated per node. Only the subtrees that overlap a byte range are visited, and a handler can skip the children of its node or stop the walk.
+//
+// A visitor lists the kinds it handles and has a handler template for them, and optionally one for the other nodes:
+//
+//   struct Visitor
+//   {
+//       using Kinds = TreeWalk::KindList<NodeKind::Qualifiers, NodeKind::Semantics>;
+//       template<NodeKind Kind> TreeWalk::Action On(const TreeWalk::Node& node);
+//       TreeWalk::Action Default(const TreeWalk::Node& node);	// Without it the children of the other nodes are visited.
+//   };
+namespace TreeWalk
+{
+	// What to do after a node.
+	enum class Action
+	{
+		Children,		// Visit its children.
+		SkipChildren,	// Go on with the next node after it.
+		Stop,
+	};
+
+	template<NodeKind... Kinds>
+	struct KindList {};
+
+	// The node being visited. Only valid during the call.
+	struct Node
+	{
+		TSNode node;
+		NodeKind kind;
+		uint32_t startByte;
+		uint32_t endByte;
+		const TSTreeCursor* pCursor;
+
+		// The field of the parent the node is in.
+		FieldKind GetField() const { return NodeKindTable::Get().GetField(*pCursor); }
+		// Relative to the node the walk started at.
+		uint32_t GetDepth() const { return ts_tree_cursor_current_depth(pCursor); }
+	};
+
+	template<typename Visitor, NodeKind... Kinds>
+	Action Dispatch(Visitor& visitor, const Node& node, KindList<Kinds...>)
+	{
+		Action action = Action::Children;
+		const bool handled = ((node.kind == Kinds && (action = visitor.template On<Kinds>(node), true)) || ...);
+		if constexpr (requires { visitor.Default(node); })
+		{
+			if (!handled)
+				action = visitor.Default(node);
+		}
+		return action;
+	}
+
+	// Visits 'root' and the nodes under it that overlap [startByte, endByte). A node that ends at startByte counts as overlapping,
+	// so empty nodes there (like a missing ';') are visited. Reuses 'cursor', resetting it to 'root'.
+	// Returns false if a handler stopped the walk.
+	template<typename Visitor>
+	bool Walk(TSTreeCursor& cursor, TSNode root, Visitor& visitor, uint32_t startByte = 0, uint32_t endByte = UINT32_MAX)
+	{
+		const NodeKindTable& table = NodeKindTable::Get();
+		ts_tree_cursor_reset(&cursor, root);
+		while (true)
+		{
+			const TSNode current = ts_tree_cursor_current_node(&cursor);
+			const uint32_t currentStart = ts_node_start_byte(current);
+			if (currentStart >= endByte)
+				return true; // Everything after it starts later.
+
+			Action action = Action::SkipChildren;
+			const uint32_t currentEnd = ts_node_end_byte(current);
+			if (currentEnd >= startByte)
+			{
+				action = Dispatch(visitor, Node{ current, table.GetKind(current), currentStart, currentEnd, &cursor }, typename Visitor::Kinds{});
+				if (action == Action::Stop)
+					return false;
+			}
+
+			if (action == Action::Children && ts_tree_cursor_goto_first_child(&cursor))
+				continue;
+
+			while (!ts_tree_cursor_goto_next_sibling(&cursor))
+			{
+				if (!ts_tree_cursor_goto_parent(&cursor))
+					return true;
+			}
+		}
+	}
+
+	template<typename Visitor>
+	bool Walk(TSNode root, Visitor& visitor, uint32_t startByte = 0, uint32_t endByte = UINT32_MAX)
+	{
+		TSTreeCursor cursor = ts_tree_cursor_new(root);
+		const bool finished = Walk(cursor, root, visitor, startByte, endByte);
+		ts_tree_cursor_delete(&cursor);
+		return finished;
+	}
+}
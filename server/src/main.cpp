@@ -1,6 +1,5 @@
 #include <lsp/messages.h>
 #include <lsp/connection.h>
-#include <lsp/io/standardio.h>
 #include <lsp/messagehandler.h>
 
 #include <tree_sitter/api.h>
@@ -9,86 +8,330 @@
 
 #include <iostream>
 #include <format>
+#include <algorithm>
+#include <cstring>
 
-#include "GapBuffer.h"
+#include "DocumentManager.h"
+#include "ParseWorkerPool.h"
+#include "AnalysisScheduler.h"
+#include "AsyncInputStream.h"
+#include "AsyncOutputStream.h"
+#include "TreeWaiters.h"
+#include "Task.h"
+#include "Log.h"
+#include "JsonEscape.h"
+#include "Trace.h"
+#include "RequestStats.h"
+#include "BatchCheck.h"
+#include "TextScan.h"
 
-void _SendMessage(lsp::MessageHandler& messageHandler, const std::string& message)
+// A window/logMessage notification. Built by hand so the logger thread can send it without going through the message handler,
+// which is only used on the message thread.
+std::string MakeLogMessageFrame(LogLevel level, LogCategory category, const std::string& message)
 {
-    lsp::ShowMessageRequestParams messageParams;
-        messageParams.type = lsp::MessageType::Info;
-        messageParams.message = message;
-        /*messageParams.actions = { lsp::MessageActionItem{"Title Test"} };*/
-        lsp::jsonrpc::MessageId messageId = messageHandler.messageDispatcher().sendRequest<lsp::requests::Window_ShowMessageRequest>(
-        lsp::requests::Window_ShowMessageRequest::Params{ messageParams },
-        [](lsp::requests::Window_ShowMessageRequest::Result&& /*result*/) {},
-        [](const lsp::Error& /*error*/) {});
+    // MessageType: Error = 1, Warning = 2, Info = 3, Log = 4
+    const int type = level >= LogLevel::Error ? 1 : level == LogLevel::Warning ? 2 : level == LogLevel::Info ? 3 : 4;
+    const std::string body = std::format(R"({{"jsonrpc":"2.0","method":"window/logMessage","params":{{"type":{},"message":"[{}] {}"}}}})",
+        type, Logger::GetCategoryName(category), EscapeJson(message));
+    return std::format("Content-Length: {}\r\n\r\n{}", body.size(), body);
 }
-#define SendMessage(msg) _SendMessage(*g_pMessageHandler, msg)
 
-void _SendLog(lsp::MessageHandler& messageHandler, const std::string& message)
+// Used for all communication between server and client.
+lsp::MessageHandler* g_pMessageHandler = nullptr;
+
+// Sends the syntax errors of the document if they changed since they were last sent, for clients that do not pull them with textDocument/diagnostic.
+void PublishDiagnostics(Document& document)
 {
-    lsp::LogMessageParams messageParams;
-    messageParams.type = lsp::MessageType::Info;
-    messageParams.message = message;
-    messageHandler.messageDispatcher().sendNotification<lsp::notifications::Window_LogMessage>(lsp::notifications::Window_LogMessage::Params{ messageParams });
+    DiagnosticCache& diagnostics = document.GetDiagnostics();
+    if (!diagnostics.Resolve(document.GetStorage(), document.GetLines(), document.GetEncoding()))
+        return;
+
+    lsp::PublishDiagnosticsParams params;
+    params.uri = lsp::Uri::parse(document.GetUri());
+    params.version = document.GetVersion();
+    params.diagnostics = diagnostics.GetResolved();
+    g_pMessageHandler->messageDispatcher().sendNotification<lsp::notifications::TextDocument_PublishDiagnostics>(std::move(params));
 }
-#define SendLog(msg) _SendLog(*g_pMessageHandler, msg)
 
-// Used for all communication between server and client.
-lsp::MessageHandler* g_pMessageHandler = nullptr;
+// Queues a reparse of the current version, reusing the unchanged parts of the retained tree.
+void Parse(ParseWorkerPool& parsers, Document& document)
+{
+    parsers.Dispatch(document.GetSnapshot(), document.CopyTree());
+}
 
-struct Walker
+// Hands the trees parsed on the workers to their documents. Results of a version that has been edited since are dropped,
+// the parse of the newer version is already queued. A document that has no tree yet keeps the result to reparse the newer version from.
+void ApplyParseResults(ParseWorkerPool& parsers, DocumentManager& documents, TreeWaiters& waiters, bool pushDiagnostics)
 {
-private:
-    TSParser* m_pParser = nullptr;
-    TSTree* m_pCurrentTree = nullptr;
-public:
-    Walker() { InitTreeSitter(); }
-    ~Walker() { DeleteTreeSitter(); }
-
-    // range: The range of the document that got changed
-    // text: The text to replace the text in the range.
-    void Parse(const lsp::Range& range, const std::string& text)
+    MSLP_TRACE_ZONE("Apply parse results");
+    parsers.PollResults([&parsers, &documents, &waiters, pushDiagnostics](ParseResult&& result)
+        {
+            if (result.pTree == nullptr)
+            {
+                MSLP_LOG(LogLevel::Warning, LogCategory::Parser, "Parsing {} version {} took too long, keeping the previous tree", result.pSnapshot->GetUri(), result.pSnapshot->GetVersion());
+                Document* pDocument = documents.Get(result.pSnapshot->GetUri());
+                if (pDocument && pDocument->GetVersion() == result.pSnapshot->GetVersion())
+                    waiters.OnParseFailed(pDocument->GetUri(), pDocument->GetVersion());
+                return;
+            }
+
+            Document* pDocument = documents.Get(result.pSnapshot->GetUri());
+            if (pDocument && pDocument->AdoptStaleTree(*result.pSnapshot, result.pTree))
+            {
+                MSLP_LOG(LogLevel::Debug, LogCategory::Parser, "Reparsing {} version {} from the tree of version {}", pDocument->GetUri(), pDocument->GetVersion(), result.pSnapshot->GetVersion());
+                Parse(parsers, *pDocument);
+                return;
+            }
+            if (pDocument == nullptr || !pDocument->SetParsedTree(*result.pSnapshot, result.pTree))
+            {
+                MSLP_LOG(LogLevel::Debug, LogCategory::Parser, "Dropped the parse of {} version {}, the document has changed", result.pSnapshot->GetUri(), result.pSnapshot->GetVersion());
+                ts_tree_delete(result.pTree);
+                return;
+            }
+
+            MSLP_LOG(LogLevel::Debug, LogCategory::Parser, "Parsed {} version {}{}", pDocument->GetUri(), pDocument->GetVersion(),
+                ts_node_has_error(ts_tree_root_node(result.pTree)) ? " with syntax errors" : "");
+            if (pushDiagnostics)
+                PublishDiagnostics(*pDocument);
+            waiters.OnParsed(pDocument->GetUri());
+        });
+}
+
+// hlslv.dumpAst <uri>: The syntax tree of the current version of the document as an S-expression.
+// Replaces logging every tree after every parse, which was slow for large documents and flooded the client's log.
+Task<lsp::requests::Workspace_ExecuteCommand::Result> DumpAst(TreeWaiters& waiters, PendingRequests& requests, lsp::jsonrpc::MessageId id, std::string uri)
+{
+    PendingRequests::Scope request(requests, id);
+    DocumentSnapshotPtr pSnapshot = co_await waiters.WaitForTree(uri, request.GetToken());
+
+    char* pString = ts_node_string(pSnapshot->GetRootNode());
+    std::string dump = pString;
+    free(pString);
+    co_return lsp::LSPAny(std::move(dump));
+}
+
+// textDocument/semanticTokens/full: All tokens of the current version, see SemanticTokens.
+Task<lsp::requests::TextDocument_SemanticTokens_Full::Result> GetSemanticTokens(TreeWaiters& waiters, DocumentManager& documents, PendingRequests& requests, lsp::jsonrpc::MessageId id, std::string uri)
+{
+    PendingRequests::Scope request(requests, id);
+    co_await waiters.WaitForTree(uri, request.GetToken());
+
+    SemanticTokens& tokens = documents.Get(uri)->GetSemanticTokens();
+    lsp::SemanticTokens result;
+    result.data.assign(tokens.GetData().begin(), tokens.GetData().end());
+    result.resultId = tokens.SaveResult();
+    co_return result;
+}
+
+// textDocument/semanticTokens/full/delta: What changed since the last result the client got, so typing does not resend the tokens of the whole document.
+Task<lsp::requests::TextDocument_SemanticTokens_Full_Delta::Result> GetSemanticTokensDelta(TreeWaiters& waiters, DocumentManager& documents, PendingRequests& requests, lsp::jsonrpc::MessageId id, std::string uri, std::string previousResultId)
+{
+    PendingRequests::Scope request(requests, id);
+    co_await waiters.WaitForTree(uri, request.GetToken());
+
+    SemanticTokens& tokens = documents.Get(uri)->GetSemanticTokens();
+    lsp::SemanticTokensEdit edit;
+    std::vector<uint32_t> data;
+    if (!tokens.GetEdit(previousResultId, edit.start, edit.deleteCount, data))
+    {
+        lsp::SemanticTokens result;
+        result.data.assign(tokens.GetData().begin(), tokens.GetData().end());
+        result.resultId = tokens.SaveResult();
+        co_return result;
+    }
+
+    lsp::SemanticTokensDelta delta;
+    if (edit.deleteCount > 0 || !data.empty())
     {
-        TSTree* pTree = ts_parser_parse_string(m_pParser, m_pCurrentTree, text.c_str(), (uint32_t)text.size());
-        TSNode rootNode = ts_tree_root_node(pTree);
-        char* pString = ts_node_string(rootNode);
-        std::string msg = pString;
-        SendLog(msg);
-        free(pString);
-        ts_tree_delete(pTree);
+        edit.data.emplace(data.begin(), data.end());
+        delta.edits.push_back(std::move(edit));
     }
+    delta.resultId = tokens.SaveResult();
+    co_return delta;
+}
 
-    TSParser* GetParser() { return m_pParser; }
+// textDocument/semanticTokens/range: The tokens of the visible part of the document, while the tokens of a large document are not there yet.
+Task<lsp::requests::TextDocument_SemanticTokens_Range::Result> GetSemanticTokensRange(TreeWaiters& waiters, DocumentManager& documents, PendingRequests& requests, lsp::jsonrpc::MessageId id, std::string uri, lsp::Range range)
+{
+    PendingRequests::Scope request(requests, id);
+    co_await waiters.WaitForTree(uri, request.GetToken());
 
-private:
-    void InitTreeSitter()
+    Document& document = *documents.Get(uri);
+    std::vector<uint32_t> data;
+    document.GetSemanticTokens().GetRange(document.GetStorage(), document.GetLines(), document.GetEncoding(), document.GetOffset(range.start), document.GetOffset(range.end), data);
+    lsp::SemanticTokens result;
+    result.data.assign(data.begin(), data.end());
+    co_return result;
+}
+
+// textDocument/diagnostic: The syntax errors of the current version, or that they are unchanged since the result the client has.
+Task<lsp::requests::TextDocument_Diagnostic::Result> GetDiagnostics(TreeWaiters& waiters, DocumentManager& documents, PendingRequests& requests, lsp::jsonrpc::MessageId id, std::string uri, std::optional<std::string> previousResultId)
+{
+    PendingRequests::Scope request(requests, id);
+    co_await waiters.WaitForTree(uri, request.GetToken());
+
+    Document& document = *documents.Get(uri);
+    DiagnosticCache& diagnostics = document.GetDiagnostics();
+    diagnostics.Resolve(document.GetStorage(), document.GetLines(), document.GetEncoding());
+    if (previousResultId == diagnostics.GetResultId())
     {
-        m_pParser = ts_parser_new();
-        ts_parser_set_language(m_pParser, tree_sitter_hlslvparser());
+        lsp::RelatedUnchangedDocumentDiagnosticReport report;
+        report.resultId = diagnostics.GetResultId();
+        co_return report;
     }
 
-    void DeleteTreeSitter()
+    lsp::RelatedFullDocumentDiagnosticReport report;
+    report.resultId = diagnostics.GetResultId();
+    report.items = diagnostics.GetResolved();
+    co_return report;
+}
+
+// hlslv.stats: Latencies of the handled messages by method, what the parsers did and what was written, as JSON. Times are in microseconds.
+Task<lsp::requests::Workspace_ExecuteCommand::Result> GetStats(RequestStats& requestStats, const ParseWorkerPool& parsers, AsyncOutputStream& output)
+{
+    const std::string json = std::format(R"({{"requests":{},"parser":{},"output":{{"messages":{},"writes":{}}}}})",
+        requestStats.ToJson(), parsers.GetStats().ToJson(), output.GetBuffer().GetMessageCount(), output.GetBuffer().GetWriteCount());
+    co_return lsp::json::parse(json);
+}
+
+// Logs a summary of the stats every interval, see --stats-interval.
+void LogStatsPeriodically(EventLoop& loop, std::chrono::seconds interval, RequestStats& requestStats, const ParseWorkerPool& parsers)
+{
+    loop.SetTimer("stats", interval, [&loop, interval, &requestStats, &parsers]()
+        {
+            const ParseWorkerPool::Stats& parseStats = parsers.GetStats();
+            MSLP_LOG(LogLevel::Info, LogCategory::Requests, "{}", requestStats.GetSummary());
+            MSLP_LOG(LogLevel::Info, LogCategory::Parser, "{} parses p99={:.1f}us, {} reparses of {} bytes p99={:.1f}us, {} cancelled, {} timed out",
+                parseStats.parseCount.load(), LatencyHistogram::ToMicroseconds(parseStats.parseTime.GetPercentile(0.99)),
+                parseStats.reparseCount.load(), parseStats.reparsedBytes.load(), LatencyHistogram::ToMicroseconds(parseStats.reparseTime.GetPercentile(0.99)),
+                parseStats.cancelledCount.load(), parseStats.timedOutCount.load());
+            LogStatsPeriodically(loop, interval, requestStats, parsers);
+        });
+}
+
+#ifdef MSLP_TRACE
+// hlslv.saveTrace [path]: Saves the recorded trace zones as Chrome trace JSON, see Trace.h. Returns the path it was saved to.
+Task<lsp::requests::Workspace_ExecuteCommand::Result> SaveTrace(std::string path)
+{
+    if (!Trace::Save(path))
+        throw lsp::RequestError(static_cast<int>(lsp::LSPErrorCodes::RequestFailed), std::format("Could not write {}", path));
+    co_return lsp::LSPAny(std::move(path));
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    EventLoop loop;
+    DocumentManager documents;
+    size_t parseThreadCount = 0;
+    std::chrono::milliseconds debounce(150);
+    uint64_t parseTimeoutMs = 5000;
+    PendingRequests requests;
+    std::string traceFile = "hlslv-trace.json";
+    std::chrono::seconds statsInterval(0);
+    std::string recordPath;
+    BatchCheck::Options check;
+    bool pushDiagnostics = true; // Unless the client pulls them, see Initialize.
+
+    // --storage=auto|gapbuffer|piecetree: The text backend of the documents.
+    // --parse-threads=N: Number of parse workers, picked from the number of cores if not given.
+    // --debounce=MS: How long a document has to be left alone after an edit before it is analyzed. 0 analyzes after every change.
+    // --parse-timeout=MS: Parses taking longer are given up and the document keeps its previous tree. 0 for no limit.
+    // --log-level=trace|debug|info|warning|error|off: Least severe level sent to the client's log.
+    // --log-categories=server,documents,parser,requests: Categories sent to the client's log, all of them if not given.
+    // --stats-interval=SECONDS: Logs a summary of the latencies every interval. 0 for never, the full stats are always available with hlslv.stats.
+    // --record=PATH: Records every message to and from the client, to replay the session with HLSLVReplay.
+    // --trace-file=PATH: Where builds with MSLP_TRACE save the trace on exit, and hlslv.saveTrace without a path.
+    // --check DIR: Checks the .hlslv files under the directory, prints the diagnostics and exits instead of serving a client (see BatchCheck).
+    // --format=text|json: How --check prints the diagnostics.
+    for (int i = 1; i < argc; ++i)
     {
-        if (m_pParser == nullptr)
-            return;
+        const std::string_view arg = argv[i];
+        if (arg.starts_with("--storage="))
+        {
+            if (arg == "--storage=gapbuffer")
+                check.storageKind = TextStorageKind::GapBuffer;
+            else if (arg == "--storage=piecetree")
+                check.storageKind = TextStorageKind::PieceTree;
+            else
+                check.storageKind = TextStorageKind::Auto;
+            documents.SetStorageKind(check.storageKind);
+        }
+        else if (arg.starts_with("--parse-threads="))
+            parseThreadCount = (size_t)std::strtoull(argv[i] + std::strlen("--parse-threads="), nullptr, 10);
+        else if (arg.starts_with("--debounce="))
+            debounce = std::chrono::milliseconds(std::strtoll(argv[i] + std::strlen("--debounce="), nullptr, 10));
+        else if (arg.starts_with("--parse-timeout="))
+            parseTimeoutMs = std::strtoull(argv[i] + std::strlen("--parse-timeout="), nullptr, 10);
+        else if (arg.starts_with("--log-level="))
+        {
+            LogLevel level;
+            if (Logger::ParseLevel(arg.substr(std::strlen("--log-level=")), level))
+                Logger::SetLevel(level);
+        }
+        else if (arg.starts_with("--log-categories="))
+            Logger::SetCategories(Logger::ParseCategories(arg.substr(std::strlen("--log-categories="))));
+        else if (arg.starts_with("--stats-interval="))
+            statsInterval = std::chrono::seconds(std::strtoll(argv[i] + std::strlen("--stats-interval="), nullptr, 10));
+        else if (arg.starts_with("--record="))
+            recordPath = arg.substr(std::strlen("--record="));
+        else if (arg.starts_with("--trace-file="))
+            traceFile = arg.substr(std::strlen("--trace-file="));
+        else if (arg == "--check" && i + 1 < argc)
+            check.directory = argv[++i];
+        else if (arg.starts_with("--check="))
+            check.directory = arg.substr(std::strlen("--check="));
+        else if (arg.starts_with("--format="))
+            check.json = arg == "--format=json";
+    }
 
-        if (m_pCurrentTree)
-            ts_tree_delete(m_pCurrentTree);
-        ts_parser_delete(m_pParser);
+    // Headless: the parse workers get every core as nothing else is running.
+    if (!check.directory.empty())
+    {
+        check.threadCount = parseThreadCount;
+        check.timeoutMicros = parseTimeoutMs * 1000;
+        return BatchCheck::Run(tree_sitter_hlslvparser(), check, std::cout);
     }
-};
 
-int main()
-{
-    GapBuffer gapBuffer;
-    gapBuffer.Create(,);
+    // Finished parses are handed to the documents on the message thread.
+    // Note: The callback refers to objects declared after the pool, it is only called once a parse has been dispatched.
+    TreeWaiters* pWaiters = nullptr;
+    ParseWorkerPool parsers(tree_sitter_hlslvparser(), parseThreadCount, parseTimeoutMs * 1000, [&loop, &parsers, &documents, &pWaiters, &pushDiagnostics]()
+        {
+            loop.Post([&parsers, &documents, &pWaiters, &pushDiagnostics]() { ApplyParseResults(parsers, documents, *pWaiters, pushDiagnostics); });
+        });
 
+    AnalysisScheduler scheduler(loop, debounce, [&parsers, &documents](const std::string& uri)
+        {
+            if (Document* pDocument = documents.Get(uri))
+                Parse(parsers, *pDocument);
+        });
 
-    Walker walker;
+    // Request handlers that need the tree of the current version co_await it (see Task).
+    TreeWaiters waiters(documents, scheduler);
+    pWaiters = &waiters;
 
     // 1: Establish a connection using standard input/output
-    lsp::Connection connection{ lsp::io::standardInput(), lsp::io::standardOutput() };
+    // Input is read on a thread of its own so that the event loop runs while waiting for messages,
+    // output is queued and written on a thread of its own so that handlers never wait for the client.
+    SessionRecorder recorder;
+    const bool recordFailed = !recordPath.empty() && !recorder.Open(recordPath);
+    SessionRecorder* pRecorder = recorder.IsOpen() ? &recorder : nullptr;
+
+    // Latencies of every handled message, see TimedHandlers and hlslv.stats.
+    RequestStats requestStats;
+    AsyncOutputStream output(pRecorder);
+    output.GetBuffer().SetOnMessage([&requestStats]() { requestStats.OnMessageWritten(); });
+    AsyncInputStream input(loop, pRecorder);
+    lsp::Connection connection{ input, output };
+
+    // Log messages are sent as window/logMessage notifications from the logger thread.
+    Logger logger([&output](LogLevel level, LogCategory category, const std::string& message)
+        {
+            output.Send(MakeLogMessageFrame(level, category, message));
+        });
+    if (recordFailed)
+        MSLP_LOG(LogLevel::Error, LogCategory::Server, "Could not create the recording {}", recordPath);
 
     // 2: Create a MessageHandler with the connection
     g_pMessageHandler = new lsp::MessageHandler(connection);
@@ -96,61 +339,158 @@ int main()
     bool running = true;
 
     // 3: Register callbacks for incoming messages
-    g_pMessageHandler->requestHandler()
+    TimedHandlers(g_pMessageHandler->requestHandler(), requestStats, input)
         // Request callbacks always have the message id as the first parameter followed by the params if there are any.
-        .add<lsp::requests::Initialize>([](const lsp::jsonrpc::MessageId& /*id*/, lsp::requests::Initialize::Params&& /*params*/)
+        .add<lsp::requests::Initialize>([&documents, &pushDiagnostics](const lsp::jsonrpc::MessageId& /*id*/, lsp::requests::Initialize::Params&& params)
             {
                 lsp::requests::Initialize::Result result;
                 // Initialize the result and return it or throw an lsp::RequestError if there was a problem
                 // Alternatively do processing asynchronously and return a std::future here
                 lsp::TextDocumentSyncOptions syncOptions;
                 syncOptions.openClose = true;
-                syncOptions.change = lsp::TextDocumentSyncKind::Full;
+                syncOptions.change = lsp::TextDocumentSyncKind::Incremental;
                 result.capabilities.textDocumentSync = syncOptions;
 
-                SendMessage("Testing LSP V2");
+                // Positions are UTF-16 code units unless the client can use UTF-8 (LSP 3.17), which are plain byte offsets into the line.
+                if (params.capabilities.general.has_value() && params.capabilities.general->positionEncodings.has_value())
+                {
+                    const std::vector<lsp::PositionEncodingKind>& encodings = *params.capabilities.general->positionEncodings;
+                    if (std::find(encodings.begin(), encodings.end(), lsp::PositionEncodingKind::UTF8) != encodings.end())
+                    {
+                        result.capabilities.positionEncoding = lsp::PositionEncodingKind::UTF8;
+                        documents.SetPositionEncoding(PositionEncoding::UTF8);
+                    }
+                }
+
+                // Syntax errors are pulled by clients that can (LSP 3.17), which then only ask for the documents they show, and pushed to the others.
+                if (params.capabilities.textDocument.has_value() && params.capabilities.textDocument->diagnostic.has_value())
+                {
+                    lsp::DiagnosticOptions diagnosticOptions;
+                    diagnosticOptions.interFileDependencies = false;
+                    diagnosticOptions.workspaceDiagnostics = false;
+                    result.capabilities.diagnosticProvider = diagnosticOptions;
+                    pushDiagnostics = false;
+                }
+
+                lsp::SemanticTokensOptions semanticTokensOptions;
+                semanticTokensOptions.legend.tokenTypes = SemanticTokens::GetTypeNames();
+                semanticTokensOptions.legend.tokenModifiers = SemanticTokens::GetModifierNames();
+                semanticTokensOptions.range = true;
+                semanticTokensOptions.full = lsp::SemanticTokensOptionsFull{ .delta = true };
+                result.capabilities.semanticTokensProvider = semanticTokensOptions;
+
+                // Commands for debugging the server, see DumpAst.
+                lsp::ExecuteCommandOptions commandOptions;
+                commandOptions.commands = { "hlslv.dumpAst", "hlslv.stats" };
+#ifdef MSLP_TRACE
+                commandOptions.commands.push_back("hlslv.saveTrace");
+#endif
+                result.capabilities.executeCommandProvider = commandOptions;
+
+                MSLP_LOG(LogLevel::Info, LogCategory::Server, "Initialized, positions are {}, text is scanned with the {} kernels",
+                    documents.GetPositionEncoding() == PositionEncoding::UTF8 ? "UTF-8" : "UTF-16", TextScan::GetKernelName());
 
                 return result;
             })
+        .add<lsp::requests::Workspace_ExecuteCommand>([&waiters, &requests, &requestStats, &parsers, &output, &traceFile](const lsp::jsonrpc::MessageId& id, lsp::ExecuteCommandParams&& params)
+            {
+                if (params.command == "hlslv.stats")
+                    return GetStats(requestStats, parsers, output).GetFuture();
+#ifdef MSLP_TRACE
+                if (params.command == "hlslv.saveTrace")
+                {
+                    const bool hasPath = params.arguments.has_value() && !params.arguments->empty() && params.arguments->front().isString();
+                    return SaveTrace(hasPath ? params.arguments->front().string() : traceFile).GetFuture();
+                }
+#else
+                (void)traceFile;
+#endif
+                if (params.command != "hlslv.dumpAst")
+                    throw lsp::RequestError(static_cast<int>(lsp::ErrorCodes::InvalidParams), std::format("Unknown command {}", params.command));
+                if (!params.arguments.has_value() || params.arguments->empty() || !params.arguments->front().isString())
+                    throw lsp::RequestError(static_cast<int>(lsp::ErrorCodes::InvalidParams), "hlslv.dumpAst expects the uri of a document");
+
+                return DumpAst(waiters, requests, id, params.arguments->front().string()).GetFuture();
+            })
+        .add<lsp::requests::TextDocument_SemanticTokens_Full>([&waiters, &documents, &requests](const lsp::jsonrpc::MessageId& id, lsp::SemanticTokensParams&& params)
+            {
+                return GetSemanticTokens(waiters, documents, requests, id, params.textDocument.uri.toString()).GetFuture();
+            })
+        .add<lsp::requests::TextDocument_SemanticTokens_Full_Delta>([&waiters, &documents, &requests](const lsp::jsonrpc::MessageId& id, lsp::SemanticTokensDeltaParams&& params)
+            {
+                return GetSemanticTokensDelta(waiters, documents, requests, id, params.textDocument.uri.toString(), std::move(params.previousResultId)).GetFuture();
+            })
+        .add<lsp::requests::TextDocument_SemanticTokens_Range>([&waiters, &documents, &requests](const lsp::jsonrpc::MessageId& id, lsp::SemanticTokensRangeParams&& params)
+            {
+                return GetSemanticTokensRange(waiters, documents, requests, id, params.textDocument.uri.toString(), params.range).GetFuture();
+            })
+        .add<lsp::requests::TextDocument_Diagnostic>([&waiters, &documents, &requests](const lsp::jsonrpc::MessageId& id, lsp::DocumentDiagnosticParams&& params)
+            {
+                return GetDiagnostics(waiters, documents, requests, id, params.textDocument.uri.toString(), std::move(params.previousResultId)).GetFuture();
+            })
         // Notifications don't have an id parameter because no response is sent back for them.
-        .add<lsp::notifications::Exit>([&running]()
+        .add<lsp::notifications::Exit>([&running, &requests]()
             {
+                requests.CancelAll();
                 running = false;
             })
-        .add<lsp::notifications::TextDocument_DidOpen>([&walker](lsp::DidOpenTextDocumentParams&& params)
+        // Requests that are still running stop at their next check and reply with RequestCancelled.
+        .add<lsp::notifications::CancelRequest>([&requests, &requestStats, &waiters](lsp::CancelParams&& params)
             {
-                SendMessage(std::format("Opened TextDocument: {}", params.textDocument.uri.path().c_str()));
-
-                std::string& text = params.textDocument.text;
-                TSTree* pTree = ts_parser_parse_string(walker.GetParser(), NULL, text.c_str(), (uint32_t)text.size());
-                TSNode rootNode = ts_tree_root_node(pTree);
-                char* pString = ts_node_string(rootNode);
-                std::string msg = pString;
-                SendLog(msg);
-                free(pString);
-                ts_tree_delete(pTree);
+                if (requests.Cancel(params.id))
+                    requestStats.RecordCancelled();
+                waiters.WakeCancelled();
+            })
+        .add<lsp::notifications::TextDocument_DidOpen>([&parsers, &scheduler, &documents](lsp::DidOpenTextDocumentParams&& params)
+            {
+                MSLP_TRACE_ZONE("textDocument/didOpen");
+
+                // A newly opened document is analyzed right away.
+                Document& document = documents.Open(params.textDocument.uri.toString(), params.textDocument.version, params.textDocument.text);
+                MSLP_LOG(LogLevel::Info, LogCategory::Documents, "Opened {} version {}", document.GetUri(), document.GetVersion());
+                scheduler.Cancel(document.GetUri());
+                Parse(parsers, document);
             })
-        .add<lsp::notifications::TextDocument_DidChange>([&walker](lsp::DidChangeTextDocumentParams&& params)
+        .add<lsp::notifications::TextDocument_DidChange>([&scheduler, &documents](lsp::DidChangeTextDocumentParams&& params)
             {
-                SendMessage(std::format("Changed TextDocument: {}", params.textDocument.uri.path().c_str()));
+                MSLP_TRACE_ZONE("textDocument/didChange");
 
-                lsp::TextDocumentContentChangeEvent_Text& textEvent = std::get<lsp::TextDocumentContentChangeEvent_Text>(params.contentChanges[0]);
-                TSTree* pTree = ts_parser_parse_string(walker.GetParser(), NULL, textEvent.text.c_str(), (uint32_t)textEvent.text.size());
+                Document* pDocument = documents.GetForChange(params.textDocument.uri.toString(), params.textDocument.version);
+                if (pDocument == nullptr)
+                {
+                    MSLP_LOG(LogLevel::Warning, LogCategory::Documents, "Dropped change to {} with stale or unknown version {}", params.textDocument.uri.toString(), params.textDocument.version);
+                    return;
+                }
 
-                TSNode rootNode = ts_tree_root_node(pTree);
-                char* pString = ts_node_string(rootNode);
-                std::string msg = pString;
-                SendLog(msg);
-                free(pString);
-                ts_tree_delete(pTree);
+                // The text is always up to date, the analysis waits for the edits to settle.
+                pDocument->ApplyChanges(params.textDocument.version, params.contentChanges);
+                scheduler.OnChanged(pDocument->GetUri());
             })
-        .add<lsp::notifications::TextDocument_DidClose>([](lsp::DidCloseTextDocumentParams&& params)
+        .add<lsp::notifications::TextDocument_DidClose>([&parsers, &scheduler, &waiters, &documents, &pushDiagnostics](lsp::DidCloseTextDocumentParams&& params)
             {
-                SendMessage(std::format("Closed TextDocument: {}", params.textDocument.uri.path().c_str()));
+                MSLP_TRACE_ZONE("textDocument/didClose");
+                MSLP_LOG(LogLevel::Info, LogCategory::Documents, "Closed {}", params.textDocument.uri.toString());
+
+                scheduler.Cancel(params.textDocument.uri.toString());
+                parsers.Cancel(params.textDocument.uri.toString());
+                documents.Close(params.textDocument.uri.toString());
+                waiters.OnClosed(params.textDocument.uri.toString());
+
+                // Pushed diagnostics stay in the client until they are replaced.
+                if (pushDiagnostics)
+                {
+                    lsp::PublishDiagnosticsParams diagnostics;
+                    diagnostics.uri = params.textDocument.uri;
+                    g_pMessageHandler->messageDispatcher().sendNotification<lsp::notifications::TextDocument_PublishDiagnostics>(std::move(diagnostics));
+                }
             });
 
     // 4: Start the message processing loop
     // processIncomingMessages Reads all current messages from the connection and if there are none waits until one becomes available
+    if (statsInterval.count() > 0)
+        LogStatsPeriodically(loop, statsInterval, requestStats, parsers);
+
+    MSLP_TRACE_THREAD("Messages");
     try
     {
         while (running)
@@ -162,6 +502,10 @@ int main()
         //e.what();
     }
 
+#ifdef MSLP_TRACE
+    Trace::Save(traceFile);
+#endif
+
     //std::cout << "Server stopped" << std::endl;
     return 0;
 }